@@ -2,4 +2,5 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
 	parser \
-	generator
+	generator \
+	benchmark
@@ -0,0 +1,50 @@
+#include <stddef.h>
+
+// counts all heap allocations of the process, including the ones Qt does with malloc directly.
+// Only possible with glibc, where the real allocator is available as __libc_*
+
+#ifdef __GLIBC__
+static unsigned long long allocationCount = 0;
+
+int qCliAllocationCountingAvailable(void)
+{
+	return 1;
+}
+
+unsigned long long qCliAllocationCount(void)
+{
+	return __atomic_load_n(&allocationCount, __ATOMIC_RELAXED);
+}
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	__atomic_fetch_add(&allocationCount, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	__atomic_fetch_add(&allocationCount, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	__atomic_fetch_add(&allocationCount, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(ptr, size);
+}
+#else
+int qCliAllocationCountingAvailable(void)
+{
+	return 0;
+}
+
+unsigned long long qCliAllocationCount(void)
+{
+	return 0;
+}
+#endif
@@ -0,0 +1,283 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+#include <qcliparser.h>
+#include <qclievaluator.h>
+
+extern "C" unsigned long long qCliAllocationCount();
+extern "C" int qCliAllocationCountingAvailable();
+
+namespace {
+
+struct Config {
+	int depth = 5;
+	int fanout = 4;
+	int options = 8;
+	int positionals = 1000;
+	int iterations = 200;
+};
+
+void printRow(const QString &name, const QString &usecs, const QString &ops, const QString &allocations)
+{
+	QTextStream out{stdout};
+	out << name.leftJustified(32)
+		<< usecs.rightJustified(12)
+		<< ops.rightJustified(14)
+		<< allocations.rightJustified(14)
+		<< '\n';
+}
+
+template <typename TFunc>
+void benchmark(const QString &name, int iterations, TFunc &&func)
+{
+	const auto allocations = qCliAllocationCount();
+	QElapsedTimer timer;
+	timer.start();
+	for(auto i = 0; i < iterations; i++)
+		func();
+	const auto nsecs = std::max<qint64>(1, timer.nsecsElapsed());
+	const auto allocationDiff = qCliAllocationCount() - allocations;
+
+	const auto nsecsPerOp = static_cast<double>(nsecs) / iterations;
+	printRow(name,
+			 QString::number(nsecsPerOp / 1000.0, 'f', 2),
+			 QString::number(1e9 / nsecsPerOp, 'f', 1),
+			 qCliAllocationCountingAvailable() ?
+				 QString::number(static_cast<double>(allocationDiff) / iterations, 'f', 1) :
+				 QStringLiteral("n/a"));
+}
+
+QString optionName(int level, int index)
+{
+	return QStringLiteral("o%1-%2").arg(level).arg(index);
+}
+
+QList<QCommandLineOption> createOptions(int level, const Config &config)
+{
+	QList<QCommandLineOption> options;
+	options.reserve(config.options);
+	for(auto i = 0; i < config.options; i++) {
+		options.append(QCommandLineOption {
+						   optionName(level, i),
+						   QStringLiteral("Option %1 of level %2").arg(i).arg(level),
+						   i % 2 == 0 ? QString() : QStringLiteral("value")
+					   });
+	}
+	return options;
+}
+
+void createTree(QCliContext *context, int level, const Config &config)
+{
+	context->addOptions(createOptions(level, config));
+	for(auto i = 0; i < config.fanout; i++) {
+		const auto name = QStringLiteral("c%1").arg(i);
+		const auto description = QStringLiteral("Command %1 of level %2").arg(i).arg(level);
+		if(level + 1 < config.depth)
+			createTree(context->addContextNode(name, description).data(), level + 1, config);
+		else {
+			auto leaf = context->addLeafNode(name, description);
+			leaf->addOptions(createOptions(level + 1, config));
+			leaf->addPositionalArgument(QStringLiteral("files"),
+										QStringLiteral("The files to process"),
+										QStringLiteral("file..."));
+		}
+	}
+}
+
+void prepareParser(QCliParser &parser, const Config &config)
+{
+	parser.addVersionOption();
+	parser.addHelpOption();
+	createTree(&parser, 0, config);
+}
+
+QStringList createArguments(const Config &config)
+{
+	// always take the first command, pass a flag and a value option on every level
+	QStringList arguments {QStringLiteral("qcliparser-benchmark")};
+	for(auto level = 0; level <= config.depth; level++) {
+		if(config.options > 1) {
+			arguments.append(QStringLiteral("--") + optionName(level, 0));
+			arguments.append(QStringLiteral("--") + optionName(level, 1));
+			arguments.append(QStringLiteral("value%1").arg(level));
+		}
+		if(level < config.depth)
+			arguments.append(QStringLiteral("c0"));
+	}
+	for(auto i = 0; i < config.positionals; i++)
+		arguments.append(QStringLiteral("file%1.txt").arg(i));
+	return arguments;
+}
+
+QStringList createContextChain(const Config &config)
+{
+	QStringList chain;
+	for(auto level = 0; level < config.depth; level++)
+		chain.append(QStringLiteral("c0"));
+	return chain;
+}
+
+}
+
+class BenchEvaluator : public QObject
+{
+	Q_OBJECT
+
+public:
+	Q_INVOKABLE explicit BenchEvaluator(QObject *parent = nullptr) :
+		QObject{parent}
+	{}
+
+	Q_INVOKABLE int exec(const QStringList &files) {
+		return files.isEmpty() ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCoreApplication::setApplicationName(QStringLiteral("qcliparser-benchmark"));
+	QCoreApplication::setApplicationVersion(QStringLiteral("4.2.0"));
+
+	QCommandLineParser cmdParser;
+	cmdParser.setApplicationDescription(QStringLiteral("Measures the hot paths of QCliParser and QCliEvaluator on synthetic trees"));
+	cmdParser.addHelpOption();
+	cmdParser.addOptions({
+							 {QStringLiteral("depth"), QStringLiteral("The <depth> of the generated tree."), QStringLiteral("depth"), QStringLiteral("5")},
+							 {QStringLiteral("fanout"), QStringLiteral("The number of <children> per context."), QStringLiteral("children"), QStringLiteral("4")},
+							 {QStringLiteral("options"), QStringLiteral("The number of <options> per node."), QStringLiteral("options"), QStringLiteral("8")},
+							 {QStringLiteral("positionals"), QStringLiteral("The <count> of positional arguments passed to the leaf."), QStringLiteral("count"), QStringLiteral("1000")},
+							 {QStringLiteral("iterations"), QStringLiteral("The number of <iterations> per benchmark."), QStringLiteral("iterations"), QStringLiteral("200")}
+						 });
+	cmdParser.process(a);
+
+	Config config;
+	config.depth = std::max(1, cmdParser.value(QStringLiteral("depth")).toInt());
+	config.fanout = std::max(1, cmdParser.value(QStringLiteral("fanout")).toInt());
+	config.options = std::max(0, cmdParser.value(QStringLiteral("options")).toInt());
+	config.positionals = std::max(0, cmdParser.value(QStringLiteral("positionals")).toInt());
+	config.iterations = std::max(1, cmdParser.value(QStringLiteral("iterations")).toInt());
+
+	const auto arguments = createArguments(config);
+	const auto chain = createContextChain(config);
+
+	QTextStream out{stdout};
+	out << "depth: " << config.depth
+		<< ", fanout: " << config.fanout
+		<< ", options: " << config.options
+		<< ", positionals: " << config.positionals
+		<< ", iterations: " << config.iterations << '\n';
+	out.flush();
+	printRow(QStringLiteral("benchmark"), QStringLiteral("us/op"), QStringLiteral("ops/s"), QStringLiteral("allocs/op"));
+
+	// tree construction and teardown
+	{
+		const auto treeIterations = std::max(1, config.iterations / 10);
+		QList<QSharedPointer<QCliParser>> parsers;
+		parsers.reserve(treeIterations);
+		benchmark(QStringLiteral("tree construction"), treeIterations, [&]() {
+			auto parser = QSharedPointer<QCliParser>::create();
+			prepareParser(*parser, config);
+			parsers.append(parser);
+		});
+		benchmark(QStringLiteral("tree teardown"), treeIterations, [&]() {
+			parsers.removeLast();
+		});
+	}
+	{
+		const auto treeIterations = std::max(1, config.iterations / 10);
+		QList<QSharedPointer<QCliParser>> parsers;
+		parsers.reserve(treeIterations);
+		benchmark(QStringLiteral("tree construction (arena)"), treeIterations, [&]() {
+			auto parser = QSharedPointer<QCliParser>::create();
+			parser->setNodeArenaEnabled(true);
+			prepareParser(*parser, config);
+			parsers.append(parser);
+		});
+		benchmark(QStringLiteral("tree teardown (arena)"), treeIterations, [&]() {
+			parsers.removeLast();
+		});
+	}
+
+	QCliParser parser;
+	prepareParser(parser, config);
+	QCliParser frozenParser;
+	prepareParser(frozenParser, config);
+	frozenParser.freeze();
+
+	// the flat equivalent of the tree: all options of every level in one parser
+	const auto prepareBaseParser = [&](QCommandLineParser &baseParser) {
+		baseParser.addHelpOption();
+		baseParser.addVersionOption();
+		for(auto level = 0; level <= config.depth; level++)
+			baseParser.addOptions(createOptions(level, config));
+	};
+	QCommandLineParser baseParser;
+	prepareBaseParser(baseParser);
+
+	// construction and parsing together, for parsers that are only used once
+	benchmark(QStringLiteral("QCommandLineParser build+parse"), config.iterations, [&]() {
+		QCommandLineParser onceParser;
+		prepareBaseParser(onceParser);
+		onceParser.parse(arguments);
+	});
+	benchmark(QStringLiteral("QCliParser build+parse"), config.iterations, [&]() {
+		QCliParser onceParser;
+		prepareParser(onceParser, config);
+		onceParser.parse(arguments);
+	});
+
+	// parsing
+	benchmark(QStringLiteral("QCommandLineParser baseline"), config.iterations, [&]() {
+		baseParser.parse(arguments);
+	});
+	benchmark(QStringLiteral("QCliParser::parse"), config.iterations, [&]() {
+		parser.parse(arguments);
+	});
+	benchmark(QStringLiteral("QCliParser::parse (frozen)"), config.iterations, [&]() {
+		frozenParser.parse(arguments);
+	});
+
+	// the same arguments as they would be passed to main()
+	QByteArrayList utf8Arguments;
+	QVector<const char*> argvArguments;
+	utf8Arguments.reserve(arguments.size());
+	argvArguments.reserve(arguments.size());
+	for(const auto &argument : arguments) {
+		utf8Arguments.append(argument.toUtf8());
+		argvArguments.append(utf8Arguments.last().constData());
+	}
+	benchmark(QStringLiteral("QCliParser::parse (argv)"), config.iterations, [&]() {
+		parser.parse(argvArguments.size(), argvArguments.constData());
+	});
+	benchmark(QStringLiteral("QCliParser::parse (frozen, argv)"), config.iterations, [&]() {
+		frozenParser.parse(argvArguments.size(), argvArguments.constData());
+	});
+
+	QCliParser evalParser;
+	prepareParser(evalParser, config);
+	if(!evalParser.parse(arguments)) {
+		qCritical().noquote() << "Failed to parse benchmark arguments:" << evalParser.errorText();
+		return EXIT_FAILURE;
+	}
+
+	// help
+	benchmark(QStringLiteral("QCliParser::helpText"), config.iterations, [&]() {
+		evalParser.helpText();
+	});
+
+	// evaluator dispatch
+	QCliEvaluator evaluator;
+	evaluator.setAutoResolveObjects(false);
+	evaluator.registerEvaluator<BenchEvaluator>(chain);
+	benchmark(QStringLiteral("QCliEvaluator::exec"), config.iterations, [&]() {
+		evaluator.exec(evalParser);
+	});
+
+	return EXIT_SUCCESS;
+}
+
+#include "main.moc"
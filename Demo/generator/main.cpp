@@ -1,6 +1,82 @@
 #include <QCoreApplication>
 #include <QDebug>
-#include <qcliparser.h>
+#include <QRandomGenerator>
+#include <qcligenerator.h>
+
+class RootGenerator : public QObject
+{
+	Q_OBJECT
+	Q_CLI_CONTEXT_OBJECT()
+
+	Q_PROPERTY(int exit_code MEMBER exit_code)
+	Q_CLI_DESCRIPTION(exit_code, "The the exit <code> to be used if the program runs successfully. The default code is 0")
+
+public:
+	Q_INVOKABLE explicit RootGenerator(QObject *parent = nullptr) :
+		QObject{parent}
+	{}
+
+	int exit_code = 0;
+};
+
+class PrintGenerator : public RootGenerator
+{
+	Q_OBJECT
+	Q_CLI_CONTEXT_OBJECT(print)
+	Q_CLI_CONTEXT_DESCRIPTION("Print various things to the console")
+
+	Q_PROPERTY(bool colored MEMBER colored)
+	Q_CLI_DESCRIPTION(colored, "Prints the graphics colored, instead of black and white")
+	Q_CLI_DESCRIPTION(qCli_sum, "print the sum of numbers")
+	Q_CLI_DESCRIPTION(qCli_sum.numbers, "The numbers to be summed up")
+
+public:
+	Q_INVOKABLE explicit PrintGenerator(QObject *parent = nullptr) :
+		RootGenerator{parent}
+	{}
+
+	Q_INVOKABLE int qCli_sum(const QStringList &numbers) {
+		auto sum = 0.0;
+		for(const auto &number : numbers)
+			sum += number.toDouble();
+		qInfo() << "Sum:" << sum << (colored ? "(colored)" : "");
+		return exit_code;
+	}
+
+	bool colored = false;
+};
+
+class MessageGenerator : public RootGenerator
+{
+	Q_OBJECT
+	Q_CLI_CONTEXT_OBJECT(message)
+	Q_CLI_CONTEXT_DESCRIPTION("print some kind of message")
+	Q_CLI_DEFAULT_NODE(random)
+
+	Q_PROPERTY(bool scream MEMBER scream)
+	Q_CLI_DESCRIPTION(scream, "Scream the message, instead of beeing friendly")
+	Q_CLI_DESCRIPTION(qCli_echo, "Echo additional arguments")
+	Q_CLI_DESCRIPTION(qCli_echo.message, "The message to be printed (can contain spaces)")
+	Q_CLI_DESCRIPTION(qCli_random, "Print some random stuff")
+
+public:
+	Q_INVOKABLE explicit MessageGenerator(QObject *parent = nullptr) :
+		RootGenerator{parent}
+	{}
+
+	Q_INVOKABLE int qCli_echo(const QStringList &message) {
+		const auto text = message.join(QLatin1Char(' '));
+		qInfo().noquote() << (scream ? text.toUpper() : text);
+		return exit_code;
+	}
+
+	Q_INVOKABLE int qCli_random() {
+		qInfo() << "Random:" << QRandomGenerator::global()->generate();
+		return exit_code;
+	}
+
+	bool scream = false;
+};
 
 int main(int argc, char *argv[])
 {
@@ -11,63 +87,16 @@ int main(int argc, char *argv[])
 	QCliParser parser;
 	parser.addVersionOption();
 	parser.addHelpOption();
-	parser.setApplicationDescription(QStringLiteral("An application to demonstrate the capabilities of QCliParser"));
-
-	parser.addOption({
-						 {QStringLiteral("e"), QStringLiteral("exit-code")},
-						 QStringLiteral("The the exit <code> to be used if the program runs successfully. "
-						 "The default code is 0"),
-						 QStringLiteral("code"),
-						 QStringLiteral("0")
-					 });
-
-	auto printNode = parser.addContextNode(QStringLiteral("print"), QStringLiteral("Print various things to the console"));
-	printNode->addOption({
-							 {QStringLiteral("c"), QStringLiteral("colored")},
-							 QStringLiteral("Prints the graphics colored, instead of black and white")
-						 });
-	auto printTreeNode = printNode->addLeafNode(QStringLiteral("tree"), QStringLiteral("print a tree"));
-	printTreeNode->addOption({
-								 QStringLiteral("size"),
-								 QStringLiteral("Choose the <size> (in pixels) the tree should be high"),
-								 QStringLiteral("size"),
-								 QStringLiteral("42")
-							 });
-	printTreeNode->addOption({
-								 QStringLiteral("season"),
-								 QStringLiteral("Choose the <season> (spring/summer/fall/winter) to show the tree for"),
-								 QStringLiteral("season"),
-								 QStringLiteral("summer")
-							 });
-	auto printNumbersNode = printNode->addLeafNode(QStringLiteral("sum"), QStringLiteral("print the sum of numbers"));
-	printNumbersNode->addPositionalArgument(QStringLiteral("numbers"),
-											QStringLiteral("The numbers to be summed up"),
-											QStringLiteral("number..."));
-
-	auto messageNode = parser.addContextNode(QStringLiteral("message"), QStringLiteral("print some kind of message"));
-	messageNode->addOption({
-							   QStringLiteral("scream"),
-							   QStringLiteral("Scream the message, instead of beeing friendly")
-						   });
-	messageNode->addOption({
-							   {QStringLiteral("f"), QStringLiteral("failure")},
-							   QStringLiteral("Print the message as failure (to stderr) instead of "
-							   "a normal message (stdout)")
-						   });
-
-	auto messageEchoNode = messageNode->addLeafNode(QStringLiteral("echo"), QStringLiteral("Echo additional arguments"));
-	messageEchoNode->addPositionalArgument(QStringLiteral("message"),
-										   QStringLiteral("The message to be printed (can contain spaces)"),
-										   QStringLiteral("[message]"));
-
-	messageNode->addLeafNode(QStringLiteral("random"), QStringLiteral("Print some random stuff"));
-	messageNode->addLeafNode(QStringLiteral("help"), QStringLiteral("print the full help information, not just the selective one"));
-	messageNode->setDefaultNode(QStringLiteral("random"));
+	parser.setApplicationDescription(QStringLiteral("An application to demonstrate the capabilities of QCliGenerator"));
 
-	parser.process(a);
+	QCliGenerator generator;
+	generator.addContext(&RootGenerator::staticMetaObject);
+	generator.addContext(&PrintGenerator::staticMetaObject);
+	generator.addContext(&MessageGenerator::staticMetaObject);
+	generator.prepareParser(parser);
 
-	qInfo() << "Context:" << parser.contextChain();
-	qInfo() << "Options:" << parser.optionNames();
-	qInfo() << "Arguments:" << parser.positionalArguments();
-	return parser.value(QStringLiteral("e")).toInt();
+	parser.process(a);
+	return generator.exec(parser);
 }
+
+#include "main.moc"
@@ -0,0 +1,311 @@
+#include "qcliargumentlist_p.h"
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTextCodec>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#ifdef Q_OS_WIN
+#  include <QtCore/qt_windows.h>
+#  include <shellapi.h>
+#endif
+
+QCliArgument::QCliArgument(QStringView utf16) :
+	_utf16(utf16),
+	_utf8(nullptr),
+	_size(static_cast<int>(utf16.size())),
+	_local8Bit(false)
+{}
+
+QCliArgument::QCliArgument(const char *utf8) :
+	QCliArgument(utf8, static_cast<int>(std::strlen(utf8)))
+{}
+
+QCliArgument::QCliArgument(const char *utf8, int size, bool local8Bit) :
+	_utf16(),
+	_utf8(utf8),
+	_size(size),
+	_local8Bit(local8Bit)
+{}
+
+int QCliArgument::size() const
+{
+	return _size;
+}
+
+char QCliArgument::at(int pos) const
+{
+	if(pos >= _size)
+		return '\0';
+	if(_utf8)
+		return static_cast<uchar>(_utf8[pos]) < 0x80 ? _utf8[pos] : '\0';
+	else
+		return _utf16[pos].unicode() < 0x80 ? static_cast<char>(_utf16[pos].unicode()) : '\0';
+}
+
+bool QCliArgument::startsWith(const char *prefix) const
+{
+	const auto length = static_cast<int>(std::strlen(prefix));
+	if(length > _size)
+		return false;
+	for(auto i = 0; i < length; ++i) {
+		if(at(i) != prefix[i])
+			return false;
+	}
+	return true;
+}
+
+int QCliArgument::indexOf(char c, int from) const
+{
+	for(auto i = from; i < _size; ++i) {
+		if(at(i) == c)
+			return i;
+	}
+	return -1;
+}
+
+int QCliArgument::nextPosition(int pos) const
+{
+	// UTF-16 advances by code unit, like QCommandLineParser does. Local encodings by byte
+	if(!_utf8 || _local8Bit)
+		return pos + 1;
+	do
+		++pos;
+	while(pos < _size && (static_cast<uchar>(_utf8[pos]) & 0xC0) == 0x80);
+	return pos;
+}
+
+QStringView QCliArgument::name(int from, int length, NameBuffer &buffer) const
+{
+	if(length < 0)
+		length = _size - from;
+	if(!_utf8)
+		return _utf16.mid(from, length);
+
+	buffer.resize(length);
+	for(auto i = 0; i < length; ++i) {
+		const auto c = static_cast<uchar>(_utf8[from + i]);
+		if(c >= 0x80) { // not plain ASCII -> decode properly
+			const auto decoded = decode(from, length);
+			buffer.resize(decoded.size());
+			std::copy(decoded.constBegin(), decoded.constEnd(), buffer.begin());
+			break;
+		}
+		buffer[i] = QLatin1Char(static_cast<char>(c));
+	}
+	return QStringView{buffer.constData(), buffer.size()};
+}
+
+QString QCliArgument::toString(int from, int length) const
+{
+	if(length < 0)
+		length = _size - from;
+	if(_utf8)
+		return decode(from, length);
+	else
+		return _utf16.mid(from, length).toString();
+}
+
+bool QCliArgument::operator==(const QString &other) const
+{
+	if(!_utf8)
+		return _utf16 == other;
+	else if(_local8Bit)
+		return other.toLocal8Bit() == QByteArray::fromRawData(_utf8, _size);
+	else
+		return other.toUtf8() == QByteArray::fromRawData(_utf8, _size);
+}
+
+QString QCliArgument::decode(int from, int length) const
+{
+	if(_local8Bit)
+		return QString::fromLocal8Bit(_utf8 + from, length);
+	else
+		return QString::fromUtf8(_utf8 + from, length);
+}
+
+
+
+QCliArgumentList::QCliArgumentList(const QStringList &arguments) :
+	_strings(arguments),
+	_argv(nullptr),
+	_argc(arguments.size()),
+	_local8Bit(false),
+	_expanded(false),
+	_entries(),
+	_responseFiles(),
+	_readData(),
+	_stdinData()
+{}
+
+QCliArgumentList::QCliArgumentList(int argc, const char *const *argv) :
+	_strings(),
+	_argv(argv),
+	_argc(argc),
+	_local8Bit(!isLocal8BitUtf8()),
+	_expanded(false),
+	_entries(),
+	_responseFiles(),
+	_readData(),
+	_stdinData()
+{
+#ifdef Q_OS_WIN
+	// argv is in the ANSI code page there, which loses characters. Same check as QCoreApplication::arguments
+	auto wideCount = 0;
+	const auto wideArgv = CommandLineToArgvW(GetCommandLineW(), &wideCount);
+	if(wideArgv) {
+		if(wideCount == argc) {
+			_strings.reserve(argc);
+			for(auto i = 0; i < argc; ++i)
+				_strings.append(QString::fromWCharArray(wideArgv[i]));
+			_argv = nullptr;
+			_local8Bit = false;
+		}
+		LocalFree(wideArgv);
+	}
+#endif
+}
+
+int QCliArgumentList::size() const
+{
+	return _expanded ? _entries.size() : _argc;
+}
+
+QCliArgument QCliArgumentList::at(int index) const
+{
+	if(_expanded) {
+		const auto &entry = _entries[index];
+		if(entry.utf8)
+			return QCliArgument{entry.utf8, entry.size, entry.local8Bit};
+		else
+			return QCliArgument{QStringView{_strings[entry.stringIndex]}};
+	} else if(_argv)
+		return QCliArgument{_argv[index], static_cast<int>(std::strlen(_argv[index])), _local8Bit};
+	else
+		return QCliArgument{QStringView{_strings[index]}};
+}
+
+QString QCliArgumentList::toString(int index, int offset) const
+{
+	const auto entry = _expanded ? _entries[index] : originalEntry(index);
+	if(entry.utf8)
+		return QCliArgument{entry.utf8, entry.size, entry.local8Bit}.toString(offset);
+	else if(offset == 0)
+		return _strings[entry.stringIndex]; // implicitly shared
+	else
+		return _strings[entry.stringIndex].mid(offset);
+}
+
+QByteArray QCliArgumentList::toUtf8(int index, int offset) const
+{
+	const auto entry = _expanded ? _entries[index] : originalEntry(index);
+	if(entry.utf8 && entry.local8Bit)
+		return QString::fromLocal8Bit(entry.utf8 + offset, entry.size - offset).toUtf8();
+	else if(entry.utf8)
+		return QByteArray::fromRawData(entry.utf8 + offset, entry.size - offset);
+	else
+		return QStringView{_strings[entry.stringIndex]}.mid(offset).toUtf8();
+}
+
+bool QCliArgumentList::expandResponseFiles(char separator, QString *errorString)
+{
+	auto hasResponseFiles = false;
+	for(auto i = 1; i < _argc && !hasResponseFiles; ++i)
+		hasResponseFiles = at(i).startsWith("@") && at(i).size() > 1;
+	if(_expanded || !hasResponseFiles)
+		return true;
+
+	QVector<Entry> entries;
+	entries.reserve(_argc);
+	entries.append(originalEntry(0));
+	for(auto i = 1; i < _argc; ++i) {
+		const auto argument = at(i);
+		if(!argument.startsWith("@") || argument.size() == 1) {
+			entries.append(originalEntry(i));
+			continue;
+		}
+
+		if(argument.size() == 2 && argument.at(1) == '-') {
+			if(_stdinData.isNull()) { // stdin can only be read once
+				QFile stdinFile;
+				if(!stdinFile.open(stdin, QIODevice::ReadOnly)) {
+					if(errorString)
+						*errorString = QStringLiteral("stdin: ") + stdinFile.errorString();
+					return false;
+				}
+				_stdinData = stdinFile.readAll();
+				if(_stdinData.isNull())
+					_stdinData = QByteArray{""};
+				appendTokens(entries, _stdinData.constData(), _stdinData.size(), separator);
+			}
+			continue;
+		}
+
+		// the file stays mapped as long as the argument list exists. Only the token positions are
+		// stored, so even huge lists are never copied
+		auto file = QSharedPointer<QFile>::create(argument.toString(1));
+		if(!file->open(QIODevice::ReadOnly)) {
+			if(errorString)
+				*errorString = file->fileName() + QStringLiteral(": ") + file->errorString();
+			return false;
+		}
+		const auto size = file->size();
+		if(size > std::numeric_limits<int>::max()) {
+			if(errorString)
+				*errorString = file->fileName() + QStringLiteral(": ") + QCoreApplication::translate("QCliParser", "File is too large");
+			return false;
+		}
+		// pipes like @<(cmd) and files without a known size (e.g. in /proc) cannot be mapped -> read them
+		const auto data = size > 0 && !file->isSequential() ?
+							  reinterpret_cast<const char*>(file->map(0, size)) :
+							  nullptr;
+		if(data) {
+			_responseFiles.append(file);
+			appendTokens(entries, data, size, separator);
+			continue;
+		}
+		const auto content = file->readAll();
+		if(file->error() != QFileDevice::NoError) {
+			if(errorString)
+				*errorString = file->fileName() + QStringLiteral(": ") + file->errorString();
+			return false;
+		}
+		_readData.append(content);
+		appendTokens(entries, content.constData(), content.size(), separator);
+	}
+
+	_entries = std::move(entries);
+	_expanded = true;
+	return true;
+}
+
+void QCliArgumentList::appendTokens(QVector<Entry> &entries, const char *data, qint64 size, char separator)
+{
+	const auto end = data + size;
+	for(auto begin = data; begin < end;) {
+		auto tokenEnd = static_cast<const char*>(std::memchr(begin, separator, static_cast<size_t>(end - begin)));
+		if(!tokenEnd)
+			tokenEnd = end;
+		auto tokenSize = static_cast<int>(tokenEnd - begin);
+		if(separator == '\n' && tokenSize > 0 && begin[tokenSize - 1] == '\r')
+			--tokenSize;
+		if(tokenSize > 0) // empty lines are skipped
+			entries.append(Entry{begin, tokenSize, -1, false});
+		begin = tokenEnd + 1;
+	}
+}
+
+QCliArgumentList::Entry QCliArgumentList::originalEntry(int index) const
+{
+	if(_argv)
+		return Entry{_argv[index], static_cast<int>(std::strlen(_argv[index])), -1, _local8Bit};
+	else
+		return Entry{nullptr, 0, index, false};
+}
+
+bool QCliArgumentList::isLocal8BitUtf8()
+{
+	// the common case on Unix. Only then argv can be read in place as UTF-8
+	const auto codec = QTextCodec::codecForLocale();
+	return !codec || codec->mibEnum() == 106;
+}
@@ -0,0 +1,90 @@
+#ifndef QCLIARGUMENTLIST_P_H
+#define QCLIARGUMENTLIST_P_H
+
+#include <QtCore/QStringList>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QFile>
+#include <QtCore/QStringView>
+#include <QtCore/QVarLengthArray>
+
+// View of a single argument, either UTF-16, UTF-8 or in the local 8 bit encoding of argv. Positions and
+// sizes are in code units of the respective encoding. Only ASCII characters can be accessed directly,
+// which is all the parser needs to find dashes and assignments
+class QCliArgument
+{
+public:
+	using NameBuffer = QVarLengthArray<QChar, 64>;
+
+	explicit QCliArgument(QStringView utf16);
+	explicit QCliArgument(const char *utf8);
+	QCliArgument(const char *utf8, int size, bool local8Bit = false);
+
+	int size() const;
+	char at(int pos) const; // '\0' for non ASCII characters
+	bool startsWith(const char *prefix) const;
+	int indexOf(char c, int from = 0) const;
+	int nextPosition(int pos) const; // position of the next code point
+
+	// converts only the given range. Names are decoded into the buffer, so short ones never allocate
+	QStringView name(int from, int length, NameBuffer &buffer) const;
+	QString toString(int from = 0, int length = -1) const;
+	bool operator==(const QString &other) const;
+
+private:
+	QStringView _utf16;
+	const char *_utf8;
+	int _size;
+	bool _local8Bit;
+
+	QString decode(int from, int length) const;
+};
+
+// The arguments of a parse run. Either a QStringList, or the argv of main(), which is never copied.
+// Arguments are only converted when read, and argv must stay valid as long as results use it. argv is
+// in the local 8 bit encoding, like QCoreApplication::arguments assumes. On Windows, where that encoding
+// cannot represent all arguments, the wide command line of the process is used instead.
+// Response files (@file) are mapped into memory and only indexed, their content is read in place
+class QCliArgumentList
+{
+	Q_DISABLE_COPY(QCliArgumentList)
+
+public:
+	explicit QCliArgumentList(const QStringList &arguments);
+	QCliArgumentList(int argc, const char *const *argv);
+
+	int size() const;
+	QCliArgument at(int index) const;
+	QString toString(int index, int offset = 0) const;
+	// without a copy for UTF-8 data. The result is not NUL-terminated
+	QByteArray toUtf8(int index, int offset = 0) const;
+
+	// replaces every "@file" argument (except the first) by the content of file, split at separator.
+	// "@-" reads from stdin, which cannot be mapped and is thus read into a single buffer, just like pipes
+	// and files without a size
+	bool expandResponseFiles(char separator, QString *errorString);
+
+private:
+	// an argument after expansion: either a UTF-8 range (argv or mapped file), or an element of _strings
+	struct Entry {
+		const char *utf8;
+		int size;
+		int stringIndex;
+		bool local8Bit; // argv in a local encoding other than UTF-8
+	};
+
+	QStringList _strings;
+	const char *const *_argv;
+	int _argc;
+	bool _local8Bit;
+	bool _expanded;
+	QVector<Entry> _entries;
+	QList<QSharedPointer<QFile>> _responseFiles;
+	QByteArrayList _readData; // response files that could not be mapped
+	QByteArray _stdinData;
+
+	Entry originalEntry(int index) const;
+	static bool isLocal8BitUtf8();
+	static void appendTokens(QVector<Entry> &entries, const char *data, qint64 size, char separator);
+};
+
+#endif // QCLIARGUMENTLIST_P_H
@@ -0,0 +1,93 @@
+#include "qclibktree_p.h"
+#include <QtCore/QVarLengthArray>
+#include <algorithm>
+
+QCliBkTree::QCliBkTree() :
+	_nodes()
+{}
+
+void QCliBkTree::insert(const QString &word)
+{
+	if(_nodes.isEmpty()) {
+		_nodes.append(Node{word, {}});
+		return;
+	}
+
+	auto index = 0;
+	forever {
+		const auto dist = distance(_nodes[index].word, word);
+		if(dist == 0) // already known
+			return;
+
+		auto &children = _nodes[index].children;
+		const auto it = std::lower_bound(children.begin(), children.end(), qMakePair(dist, -1));
+		if(it != children.end() && it->first == dist)
+			index = it->second;
+		else {
+			children.insert(it, qMakePair(dist, _nodes.size()));
+			_nodes.append(Node{word, {}}); // invalidates children
+			return;
+		}
+	}
+}
+
+int QCliBkTree::size() const
+{
+	return _nodes.size();
+}
+
+QStringList QCliBkTree::find(QStringView word, int maxDistance, int maxResults) const
+{
+	if(_nodes.isEmpty())
+		return {};
+
+	QVector<QPair<int, int>> matches; // (distance, node index)
+	QVarLengthArray<int, 64> stack;
+	stack.append(0);
+	while(!stack.isEmpty()) {
+		const auto &node = _nodes[stack.takeLast()];
+		const auto dist = distance(node.word, word);
+		if(dist <= maxDistance)
+			matches.append(qMakePair(dist, static_cast<int>(&node - _nodes.constData())));
+
+		// only children with |edge - dist| <= maxDistance can contain matches
+		const auto begin = std::lower_bound(node.children.constBegin(), node.children.constEnd(),
+											qMakePair(dist - maxDistance, -1));
+		for(auto it = begin; it != node.children.constEnd() && it->first <= dist + maxDistance; ++it)
+			stack.append(it->second);
+	}
+
+	std::sort(matches.begin(), matches.end(), [this](const QPair<int, int> &lhs, const QPair<int, int> &rhs) {
+		if(lhs.first != rhs.first)
+			return lhs.first < rhs.first;
+		return _nodes[lhs.second].word < _nodes[rhs.second].word;
+	});
+	QStringList words;
+	for(auto i = 0; i < matches.size() && i < maxResults; ++i)
+		words.append(_nodes[matches[i].second].word);
+	return words;
+}
+
+int QCliBkTree::distance(QStringView lhs, QStringView rhs)
+{
+	// Levenshtein with a single row. Case differences count, like they do for the parser
+	QVarLengthArray<int, 64> row(static_cast<int>(rhs.size()) + 1);
+	for(auto j = 0; j < row.size(); ++j)
+		row[j] = j;
+	for(auto i = 0; i < lhs.size(); ++i) {
+		auto diagonal = row[0];
+		row[0] = i + 1;
+		for(auto j = 0; j < rhs.size(); ++j) {
+			const auto above = row[j + 1];
+			row[j + 1] = std::min({above + 1, row[j] + 1, diagonal + (lhs[i] == rhs[j] ? 0 : 1)});
+			diagonal = above;
+		}
+	}
+	return row[rhs.size()];
+}
+
+int QCliBkTree::maxDistanceFor(QStringView word)
+{
+	// one typo per three characters, but at least one and at most three
+	return std::max(1, std::min(3, static_cast<int>(word.size()) / 3));
+}
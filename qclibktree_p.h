@@ -0,0 +1,35 @@
+#ifndef QCLIBKTREE_P_H
+#define QCLIBKTREE_P_H
+
+#include <QtCore/QStringList>
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+
+// Burkhard-Keller tree over the Levenshtein distance. Every child edge is labeled with the distance
+// to its parent, so a query within a maximum distance only descends into the edges that the
+// triangle inequality allows, instead of comparing against every word
+class QCliBkTree
+{
+public:
+	QCliBkTree();
+
+	void insert(const QString &word);
+	int size() const;
+
+	// words within maxDistance, sorted by distance and then by name
+	QStringList find(QStringView word, int maxDistance, int maxResults) const;
+
+	static int distance(QStringView lhs, QStringView rhs);
+	static int maxDistanceFor(QStringView word);
+
+private:
+	struct Node {
+		QString word;
+		// (distance, node index), sorted by distance
+		QVector<QPair<int, int>> children;
+	};
+
+	QVector<Node> _nodes;
+};
+
+#endif // QCLIBKTREE_P_H
@@ -0,0 +1,688 @@
+#include "qclicompleter_p.h"
+#include "qclicompletionindex.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// string table of the completion index. Offset 0 is the empty string
+class IndexStrings
+{
+public:
+	IndexStrings() :
+		_data(1, '\0'),
+		_offsets()
+	{}
+
+	quint32 add(const QString &string) {
+		if(string.isEmpty())
+			return 0;
+		const auto utf8 = string.toUtf8();
+		auto it = _offsets.constFind(utf8);
+		if(it == _offsets.constEnd()) {
+			it = _offsets.insert(utf8, static_cast<quint32>(_data.size()));
+			_data.append(utf8);
+			_data.append('\0');
+		}
+		return *it;
+	}
+
+	const QByteArray &data() const {
+		return _data;
+	}
+
+private:
+	QByteArray _data;
+	QHash<QByteArray, quint32> _offsets;
+};
+
+template <typename T>
+void appendRaw(QByteArray &target, const T *data, int count)
+{
+	target.append(reinterpret_cast<const char*>(data), count * static_cast<int>(sizeof(T)));
+}
+
+quint64 fnv1a64(const QByteArray &data, quint64 hash = 14695981039346656037ull)
+{
+	for(const auto c : data) {
+		hash ^= static_cast<uchar>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+}
+
+QCliPrefixTrie::QCliPrefixTrie() :
+	_nodes{Node{}}
+{}
+
+bool QCliPrefixTrie::insert(QStringView key, int value)
+{
+	auto node = 0;
+	for(const auto c : key) {
+		// find the child, or the sibling after which it has to be inserted to keep the order
+		auto previous = -1;
+		auto child = _nodes[node].firstChild;
+		while(child != -1 && _nodes[child].character < c) {
+			previous = child;
+			child = _nodes[child].nextSibling;
+		}
+		if(child == -1 || _nodes[child].character != c) {
+			Node newNode;
+			newNode.character = c;
+			newNode.nextSibling = child;
+			_nodes.append(newNode);
+			child = _nodes.size() - 1;
+			if(previous == -1)
+				_nodes[node].firstChild = child;
+			else
+				_nodes[previous].nextSibling = child;
+		}
+		node = child;
+	}
+
+	if(_nodes[node].value != -1)
+		return false;
+	_nodes[node].value = value;
+	return true;
+}
+
+int QCliPrefixTrie::find(QStringView key) const
+{
+	const auto node = findNode(key);
+	return node == -1 ? -1 : _nodes[node].value;
+}
+
+QVector<int> QCliPrefixTrie::findPrefix(QStringView prefix) const
+{
+	QVector<int> values;
+	const auto start = findNode(prefix);
+	if(start == -1)
+		return values;
+
+	// pre-order traversal: children are visited before the next sibling
+	if(_nodes[start].value != -1)
+		values.append(_nodes[start].value);
+	QVector<int> stack;
+	if(_nodes[start].firstChild != -1)
+		stack.append(_nodes[start].firstChild);
+	while(!stack.isEmpty()) {
+		const auto &node = _nodes[stack.takeLast()];
+		if(node.nextSibling != -1)
+			stack.append(node.nextSibling);
+		if(node.value != -1)
+			values.append(node.value);
+		if(node.firstChild != -1)
+			stack.append(node.firstChild);
+	}
+	return values;
+}
+
+int QCliPrefixTrie::findNode(QStringView key) const
+{
+	auto node = 0;
+	for(const auto c : key) {
+		auto child = _nodes[node].firstChild;
+		while(child != -1 && _nodes[child].character < c)
+			child = _nodes[child].nextSibling;
+		if(child == -1 || _nodes[child].character != c)
+			return -1;
+		node = child;
+	}
+	return node;
+}
+
+
+
+QCliCompleter::QCliCompleter(const QList<QCommandLineOption> &builtinOptions, QCommandLineParser::SingleDashWordOptionMode singleDashWordOptionMode) :
+	_singleDashWordOptionMode(singleDashWordOptionMode),
+	_builtinIndex(),
+	_optionIndexes(),
+	_childIndexes()
+{
+	auto index = QSharedPointer<OptionIndex>::create();
+	for(const auto &option : builtinOptions)
+		addOption(*index, toOption(option));
+	_builtinIndex = index;
+}
+
+QStringList QCliCompleter::complete(const QCliNode *root, const QStringList &words, int currentWord)
+{
+	if(currentWord < 1)
+		return {};
+	return completeNode(root, words, currentWord);
+}
+
+QStringList QCliCompleter::complete(const QCliStaticNode *root, const QStringList &words, int currentWord)
+{
+	if(currentWord < 1)
+		return {};
+	return completeNode(root, words, currentWord);
+}
+
+QByteArray QCliCompleter::createIndex(const QCliNode *root, const QFileInfo &program) const
+{
+	return createIndexImpl(root, program);
+}
+
+QByteArray QCliCompleter::createIndex(const QCliStaticNode *root, const QFileInfo &program) const
+{
+	return createIndexImpl(root, program);
+}
+
+QString QCliCompleter::script(const QString &shell, const QString &programName, const QString &indexFile)
+{
+	auto identifier = programName;
+	for(auto &c : identifier) {
+		if(!c.isLetterOrNumber())
+			c = QLatin1Char('_');
+	}
+
+	// with an index, the standalone resolver answers first. It fails for unknown or lazy nodes,
+	// in which case the application itself is asked
+	const auto posixQuote = [&]() {
+		return QLatin1Char('\'') + QString{indexFile}.replace(QLatin1Char('\''), QStringLiteral("'\\''")) + QLatin1Char('\'');
+	};
+	const auto fishQuote = [&]() {
+		return QLatin1Char('\'') + QString{indexFile}
+				.replace(QLatin1Char('\\'), QStringLiteral("\\\\"))
+				.replace(QLatin1Char('\''), QStringLiteral("\\'")) + QLatin1Char('\'');
+	};
+
+	if(shell == QStringLiteral("bash")) {
+		auto query = QStringLiteral(R"__("${COMP_WORDS[0]}" --__complete "$COMP_CWORD" "${COMP_WORDS[@]}")__");
+		if(!indexFile.isEmpty())
+			query = QStringLiteral(R"__({ qcliparser-complete %1 "$COMP_CWORD" "${COMP_WORDS[@]}" || %2; })__").arg(posixQuote(), query);
+		return QStringLiteral(R"__(_%2_complete()
+{
+	local IFS=$'\n'
+	local line
+	local candidates=()
+	COMPREPLY=()
+	while IFS= read -r line; do
+		if [[ $line == :files* ]]; then
+			compopt -o default
+			return
+		fi
+		[[ -n $line ]] && candidates+=("${line%%$'\t'*}")
+	done < <(%3 2>/dev/null)
+	COMPREPLY=("${candidates[@]}")
+}
+complete -F _%2_complete %1
+)__").arg(programName, identifier, query);
+	} else if(shell == QStringLiteral("zsh")) {
+		auto query = QStringLiteral(R"__("${words[1]}" --__complete $((CURRENT - 1)) "${words[@]}")__");
+		if(!indexFile.isEmpty())
+			query = QStringLiteral(R"__({ qcliparser-complete %1 $((CURRENT - 1)) "${words[@]}" || %2; })__").arg(posixQuote(), query);
+		return QStringLiteral(R"__(#compdef %1
+_%2_complete()
+{
+	local -a candidates
+	local line name description
+	for line in "${(@f)$(%3 2>/dev/null)}"; do
+		if [[ $line == :files* ]]; then
+			_files
+			return
+		fi
+		[[ -z $line ]] && continue
+		name=${line%%$'\t'*}
+		description=
+		[[ $line == *$'\t'* ]] && description=${line#*$'\t'}
+		candidates+=("${name//:/\\:}:$description")
+	done
+	_describe 'command' candidates
+}
+compdef _%2_complete %1
+)__").arg(programName, identifier, query);
+	} else if(shell == QStringLiteral("fish")) {
+		auto query = QStringLiteral("$words[1] --__complete $cword $words");
+		if(!indexFile.isEmpty())
+			query = QStringLiteral("begin; qcliparser-complete %1 $cword $words; or %2; end").arg(fishQuote(), query);
+		return QStringLiteral(R"__(function __%2_complete
+	set -l words (commandline -opc) (commandline -ct)
+	set -l cword (count (commandline -opc))
+	for line in (%3 2>/dev/null)
+		if string match -q -- ':files*' $line
+			__fish_complete_path (commandline -ct)
+			return
+		end
+		echo $line
+	end
+end
+complete -c %1 -f -a '(__%2_complete)'
+)__").arg(programName, identifier, query);
+	} else
+		return {};
+}
+
+template <typename TNode>
+QStringList QCliCompleter::completeNode(const TNode *node, const QStringList &words, int currentWord)
+{
+	auto options = enterNode(node, _builtinIndex);
+
+	// walk all words before the current one to find the node that is completed
+	auto positionalOnly = false;
+	auto positionalIndex = 0;
+	const auto lastWord = std::min(currentWord, words.size());
+	for(auto i = 1; i < lastWord; i++) {
+		const auto &word = words[i];
+		if(!positionalOnly && word == QStringLiteral("--")) {
+			positionalOnly = true;
+			continue;
+		}
+
+		if(!positionalOnly && word.size() > 1 && word.startsWith(QLatin1Char('-'))) {
+			auto inlineValue = false;
+			const auto optionIndex = valueOption(*options, word, inlineValue);
+			if(optionIndex != -1 && !inlineValue && ++i == lastWord) // the current word is the value
+				return {filesLine(options->options[optionIndex].valueName)};
+			continue;
+		}
+
+		if(isContext(node)) {
+			node = findChild(node, word);
+			if(!node) // unknown command -> nothing to complete
+				return {};
+			options = enterNode(node, options);
+		} else
+			positionalIndex++;
+	}
+
+	const auto prefix = words.value(currentWord);
+	if(!positionalOnly && prefix.startsWith(QLatin1Char('-'))) {
+		auto inlineValue = false;
+		const auto optionIndex = valueOption(*options, prefix, inlineValue);
+		if(optionIndex != -1 && inlineValue)
+			return {filesLine(options->options[optionIndex].valueName)};
+		else
+			return optionCandidates(*options, prefix);
+	} else if(isContext(node))
+		return childCandidates(*childIndex(node), prefix);
+	else {
+		// additional arguments are treated like the last one (e.g. "files...")
+		const auto hints = positionalHints(node);
+		return {filesLine(hints.isEmpty() ? QString() : hints[std::min(positionalIndex, hints.size() - 1)])};
+	}
+}
+
+template <typename TNode>
+QByteArray QCliCompleter::createIndexImpl(const TNode *root, const QFileInfo &program) const
+{
+	struct Entry {
+		const TNode *node;
+		Candidate candidate;
+	};
+
+	IndexStrings strings;
+	QVector<QCliIndexNode> nodes;
+	QVector<QCliIndexOption> options;
+	QVector<quint32> names;
+	const auto addOptions = [&](const QVector<Option> &nodeOptions) {
+		for(const auto &option : nodeOptions) {
+			QCliIndexOption indexOption;
+			indexOption.firstName = static_cast<quint32>(names.size());
+			indexOption.nameCount = static_cast<quint32>(option.names.size());
+			for(const auto &name : option.names)
+				names.append(strings.add(name));
+			indexOption.description = strings.add(option.description.simplified());
+			indexOption.valueName = strings.add(option.valueName);
+			indexOption.flags = 0;
+			if(option.hidden)
+				indexOption.flags |= QCliIndexHidden;
+			if(!option.valueName.isEmpty())
+				indexOption.flags |= QCliIndexTakesValue;
+			options.append(indexOption);
+		}
+	};
+
+	// breadth first, so the children of every node are contiguous
+	QVector<Entry> entries {Entry{root, Candidate{QString(), QString(), false}}};
+	for(auto i = 0; i < entries.size(); i++) {
+		const auto entry = entries[i];
+		QCliIndexNode indexNode;
+		indexNode.name = strings.add(entry.candidate.name);
+		indexNode.description = strings.add(entry.candidate.description.simplified());
+		indexNode.flags = 0;
+		if(entry.candidate.hidden)
+			indexNode.flags |= QCliIndexHidden;
+		indexNode.firstChild = 0;
+		indexNode.childCount = 0;
+		indexNode.defaultChild = QCLI_INDEX_NONE;
+		indexNode.firstOption = static_cast<quint32>(options.size());
+		indexNode.firstPositional = static_cast<quint32>(names.size());
+		indexNode.positionalCount = 0;
+
+		if(isLazy(entry.node)) {
+			// the content of lazy contexts is only known at runtime -> the resolver has to ask the application
+			indexNode.flags |= QCliIndexContext | QCliIndexLazy;
+		} else {
+			if(i == 0)
+				addOptions(_builtinIndex->options);
+			addOptions(nodeOptions(entry.node));
+
+			const auto hints = positionalHints(entry.node);
+			for(const auto &hint : hints)
+				names.append(strings.add(hint));
+			indexNode.positionalCount = static_cast<quint32>(hints.size());
+
+			if(isContext(entry.node)) {
+				indexNode.flags |= QCliIndexContext;
+				auto childList = children(entry.node);
+				std::sort(childList.begin(), childList.end(), [](const Candidate &lhs, const Candidate &rhs) {
+					return lhs.name.toUtf8() < rhs.name.toUtf8();
+				});
+				indexNode.firstChild = static_cast<quint32>(entries.size());
+				indexNode.childCount = static_cast<quint32>(childList.size());
+				const auto defaultName = defaultChild(entry.node);
+				for(const auto &child : childList) {
+					if(child.name == defaultName)
+						indexNode.defaultChild = static_cast<quint32>(entries.size());
+					entries.append(Entry{findChild(entry.node, child.name), child});
+				}
+			}
+		}
+		indexNode.optionCount = static_cast<quint32>(options.size()) - indexNode.firstOption;
+		nodes.append(indexNode);
+	}
+
+	QCliIndexHeader header;
+	std::memset(&header, 0, sizeof(header));
+	if(program.exists()) {
+		header.program = strings.add(program.absoluteFilePath());
+		header.programModified = program.lastModified().toSecsSinceEpoch();
+		header.programSize = static_cast<quint64>(program.size());
+	}
+	std::memcpy(header.magic, QCLI_INDEX_MAGIC, sizeof(QCLI_INDEX_MAGIC));
+	header.version = QCLI_INDEX_VERSION;
+	if(_singleDashWordOptionMode == QCommandLineParser::ParseAsLongOptions)
+		header.flags |= QCliIndexLongOptions;
+	header.nodeCount = static_cast<quint32>(nodes.size());
+	header.nodeOffset = sizeof(QCliIndexHeader);
+	header.optionCount = static_cast<quint32>(options.size());
+	header.optionOffset = header.nodeOffset + header.nodeCount * sizeof(QCliIndexNode);
+	header.nameCount = static_cast<quint32>(names.size());
+	header.nameOffset = header.optionOffset + header.optionCount * sizeof(QCliIndexOption);
+	header.stringSize = static_cast<quint32>(strings.data().size());
+	header.stringOffset = header.nameOffset + header.nameCount * sizeof(quint32);
+
+	QByteArray body;
+	body.reserve(static_cast<int>(header.stringOffset + header.stringSize - header.nodeOffset));
+	appendRaw(body, nodes.constData(), nodes.size());
+	appendRaw(body, options.constData(), options.size());
+	appendRaw(body, names.constData(), names.size());
+	body.append(strings.data());
+	header.schemaHash = fnv1a64(body, fnv1a64(QByteArray::number(header.flags)));
+
+	QByteArray index;
+	index.reserve(static_cast<int>(sizeof(header)) + body.size());
+	appendRaw(index, &header, 1);
+	index.append(body);
+	return index;
+}
+
+void QCliCompleter::addOption(OptionIndex &index, const Option &option)
+{
+	// same semantics as QCommandLineParser::addOptions: options with already known names are skipped
+	for(const auto &name : option.names) {
+		if(index.trie.find(name) != -1)
+			return;
+	}
+
+	index.options.append(option);
+	for(const auto &name : option.names) {
+		index.names.append(qMakePair(name, index.options.size() - 1));
+		index.trie.insert(name, index.names.size() - 1);
+	}
+}
+
+template <typename TNode>
+QSharedPointer<const QCliCompleter::OptionIndex> QCliCompleter::enterNode(const TNode *node, const QSharedPointer<const OptionIndex> &parentIndex)
+{
+	// every node has exactly one parent chain, so the node alone identifies its options
+	const auto it = _optionIndexes.constFind(node);
+	if(it != _optionIndexes.constEnd())
+		return *it;
+
+	const auto options = nodeOptions(node);
+	if(options.isEmpty()) {
+		_optionIndexes.insert(node, parentIndex);
+		return parentIndex;
+	}
+	auto index = QSharedPointer<OptionIndex>::create(*parentIndex);
+	for(const auto &option : options)
+		addOption(*index, option);
+	_optionIndexes.insert(node, index);
+	return index;
+}
+
+template <typename TNode>
+QSharedPointer<const QCliCompleter::ChildIndex> QCliCompleter::childIndex(const TNode *node)
+{
+	const auto it = _childIndexes.constFind(node);
+	if(it != _childIndexes.constEnd())
+		return *it;
+
+	auto index = QSharedPointer<ChildIndex>::create();
+	index->children = children(node);
+	for(auto i = 0; i < index->children.size(); i++) {
+		if(!index->children[i].hidden)
+			index->trie.insert(index->children[i].name, i);
+	}
+	_childIndexes.insert(node, index);
+	return index;
+}
+
+QCliCompleter::Option QCliCompleter::toOption(const QCommandLineOption &option)
+{
+	return {
+		option.names(),
+		option.description(),
+		option.valueName(),
+		option.flags().testFlag(QCommandLineOption::HiddenFromHelp)
+	};
+}
+
+QVector<QCliCompleter::Option> QCliCompleter::nodeOptions(const QCliNode *node)
+{
+	QVector<Option> options;
+	options.reserve(node->_options.size());
+	for(const auto &option : node->_options)
+		options.append(toOption(option));
+	return options;
+}
+
+QVector<QCliCompleter::Option> QCliCompleter::nodeOptions(const QCliStaticNode *node)
+{
+	QVector<Option> options;
+	options.reserve(node->optionCount);
+	for(auto i = 0; i < node->optionCount; i++) {
+		const auto &option = node->options[i];
+		options.append({
+						   QString::fromLatin1(option.names).split(QLatin1Char('|')),
+						   QString::fromUtf8(option.description),
+						   QString::fromLatin1(option.valueName),
+						   option.hidden
+					   });
+	}
+	return options;
+}
+
+bool QCliCompleter::isContext(const QCliNode *node)
+{
+	return dynamic_cast<const QCliContext*>(node);
+}
+
+bool QCliCompleter::isContext(const QCliStaticNode *node)
+{
+	return node->type == QCliStaticNode::Context;
+}
+
+const QCliNode *QCliCompleter::findChild(const QCliNode *node, const QString &name)
+{
+	const auto context = static_cast<const QCliContext*>(node);
+	context->createLazyNodes();
+	const auto it = context->_nodes.constFind(name);
+	if(it == context->_nodes.constEnd())
+		return nullptr;
+	else
+		return it->second.data();
+}
+
+const QCliStaticNode *QCliCompleter::findChild(const QCliStaticNode *node, const QString &name)
+{
+	const auto begin = node->children;
+	const auto end = node->children + node->childCount;
+	const auto it = std::lower_bound(begin, end, name, [](const QCliStaticNode &child, const QString &key) {
+		return QString::compare(QLatin1String{child.name}, key) < 0;
+	});
+	if(it != end && QLatin1String{it->name} == name)
+		return it;
+	else
+		return nullptr;
+}
+
+bool QCliCompleter::isLazy(const QCliNode *node)
+{
+	// not isLazy(), as that changes once the nodes have been created
+	const auto context = dynamic_cast<const QCliContext*>(node);
+	return context && context->_factory;
+}
+
+bool QCliCompleter::isLazy(const QCliStaticNode *node)
+{
+	Q_UNUSED(node)
+	return false;
+}
+
+QVector<QCliCompleter::Candidate> QCliCompleter::children(const QCliNode *node)
+{
+	const auto context = static_cast<const QCliContext*>(node);
+	context->createLazyNodes();
+	QVector<Candidate> candidates;
+	candidates.reserve(context->_nodes.size());
+	for(auto it = context->_nodes.constBegin(); it != context->_nodes.constEnd(); ++it)
+		candidates.append(Candidate{it.key(), it->first, it->second->isHidden()});
+	return candidates;
+}
+
+QVector<QCliCompleter::Candidate> QCliCompleter::children(const QCliStaticNode *node)
+{
+	QVector<Candidate> candidates;
+	candidates.reserve(node->childCount);
+	for(auto i = 0; i < node->childCount; i++) {
+		const auto &child = node->children[i];
+		candidates.append(Candidate{QString::fromLatin1(child.name), QString::fromUtf8(child.description), child.hidden});
+	}
+	return candidates;
+}
+
+QString QCliCompleter::defaultChild(const QCliNode *node)
+{
+	return static_cast<const QCliContext*>(node)->_defaultNode;
+}
+
+QString QCliCompleter::defaultChild(const QCliStaticNode *node)
+{
+	return QString::fromLatin1(node->defaultNode);
+}
+
+QStringList QCliCompleter::positionalHints(const QCliNode *node)
+{
+	QStringList hints;
+	if(const auto leaf = dynamic_cast<const QCliLeaf*>(node)) {
+		hints.reserve(leaf->_arguments.size());
+		for(const auto &argument : leaf->_arguments)
+			hints.append(std::get<2>(argument));
+	}
+	return hints;
+}
+
+QStringList QCliCompleter::positionalHints(const QCliStaticNode *node)
+{
+	QStringList hints;
+	hints.reserve(node->positionalCount);
+	for(auto i = 0; i < node->positionalCount; i++) {
+		const auto &positional = node->positionals[i];
+		if(positional.syntax)
+			hints.append(QString::fromLatin1(positional.syntax));
+		else
+			hints.append(QStringLiteral("<%1>").arg(QString::fromLatin1(positional.name)));
+	}
+	return hints;
+}
+
+int QCliCompleter::valueOption(const OptionIndex &index, const QString &word, bool &inlineValue) const
+{
+	// returns the option that takes a value from this word or the next one, if any
+	const auto lookup = [&index](const QString &name) {
+		const auto entry = index.trie.find(name);
+		if(entry == -1)
+			return -1;
+		const auto optionIndex = index.names[entry].second;
+		return index.options[optionIndex].valueName.isEmpty() ? -1 : optionIndex;
+	};
+
+	if(word.startsWith(QStringLiteral("--")) ||
+	   _singleDashWordOptionMode == QCommandLineParser::ParseAsLongOptions) {
+		const auto name = word.mid(word.startsWith(QStringLiteral("--")) ? 2 : 1);
+		const auto assignPos = name.indexOf(QLatin1Char('='));
+		inlineValue = assignPos != -1;
+		return lookup(name.left(assignPos));
+	}
+
+	// compacted short options: the first one that takes a value consumes the rest of the word
+	for(auto pos = 1; pos < word.size(); ++pos) {
+		const auto optionIndex = lookup(word.mid(pos, 1));
+		if(optionIndex != -1) {
+			inlineValue = pos + 1 < word.size();
+			return optionIndex;
+		}
+	}
+	return -1;
+}
+
+QStringList QCliCompleter::optionCandidates(const OptionIndex &index, const QString &prefix)
+{
+	// search with the name part of the prefix, then filter by the dashes that were typed
+	auto name = prefix.mid(1);
+	if(name.startsWith(QLatin1Char('-')))
+		name.remove(0, 1);
+
+	QStringList candidates;
+	for(const auto entry : index.trie.findPrefix(name)) {
+		const auto &optionName = index.names[entry];
+		const auto &option = index.options[optionName.second];
+		if(option.hidden)
+			continue;
+		const auto dashedName = (optionName.first.size() == 1 ? QStringLiteral("-") : QStringLiteral("--")) + optionName.first;
+		if(dashedName.startsWith(prefix))
+			candidates.append(candidateLine(dashedName, option.description));
+	}
+	return candidates;
+}
+
+QStringList QCliCompleter::childCandidates(const ChildIndex &index, const QString &prefix)
+{
+	QStringList candidates;
+	for(const auto child : index.trie.findPrefix(prefix))
+		candidates.append(candidateLine(index.children[child].name, index.children[child].description));
+	return candidates;
+}
+
+QString QCliCompleter::candidateLine(const QString &name, const QString &description)
+{
+	const auto simpleDescription = description.simplified();
+	if(simpleDescription.isEmpty())
+		return name;
+	else
+		return name + QLatin1Char('\t') + simpleDescription;
+}
+
+QString QCliCompleter::filesLine(const QString &hint)
+{
+	if(hint.isEmpty())
+		return QStringLiteral(":files");
+	else
+		return QStringLiteral(":files\t") + hint;
+}
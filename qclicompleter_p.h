@@ -0,0 +1,126 @@
+#ifndef QCLICOMPLETER_P_H
+#define QCLICOMPLETER_P_H
+
+#include "qclinode.h"
+#include "qclistaticschema.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+
+// Prefix tree over names. Siblings are kept sorted, so prefix queries return values in key order
+class QCliPrefixTrie
+{
+public:
+	QCliPrefixTrie();
+
+	bool insert(QStringView key, int value);
+	int find(QStringView key) const;
+	QVector<int> findPrefix(QStringView prefix) const;
+
+private:
+	struct Node {
+		QChar character;
+		int firstChild = -1;
+		int nextSibling = -1;
+		int value = -1;
+	};
+
+	QVector<Node> _nodes;
+
+	int findNode(QStringView key) const;
+};
+
+// Resolves the completion candidates for a partial command line. The words are walked along the
+// tree, only the entered nodes are visited. Candidates are written as "name\tdescription", or as a
+// single ":files\t<hint>" line if a free value (option value or positional argument) is expected.
+// The tries of every entered node are kept, so a completer that is reused for a tree that cannot
+// change anymore answers later queries without building them again.
+// The completer can also serialize the whole tree into a completion index (see qclicompletionindex.h)
+class QCliCompleter
+{
+	Q_DISABLE_COPY(QCliCompleter)
+
+public:
+	QCliCompleter(const QList<QCommandLineOption> &builtinOptions,
+				  QCommandLineParser::SingleDashWordOptionMode singleDashWordOptionMode);
+
+	QStringList complete(const QCliNode *root, const QStringList &words, int currentWord);
+	QStringList complete(const QCliStaticNode *root, const QStringList &words, int currentWord);
+
+	// program is the application binary, recorded so that resolvers can detect outdated indexes
+	QByteArray createIndex(const QCliNode *root, const QFileInfo &program) const;
+	QByteArray createIndex(const QCliStaticNode *root, const QFileInfo &program) const;
+
+	static QString script(const QString &shell, const QString &programName, const QString &indexFile = QString());
+
+private:
+	struct Option {
+		QStringList names;
+		QString description;
+		QString valueName;
+		bool hidden;
+	};
+
+	struct Candidate {
+		QString name;
+		QString description;
+		bool hidden;
+	};
+
+	// all options available in a node, including the inherited ones
+	struct OptionIndex {
+		QVector<Option> options;
+		QVector<QPair<QString, int>> names;
+		QCliPrefixTrie trie;
+	};
+
+	// the visible children of a context
+	struct ChildIndex {
+		QVector<Candidate> children;
+		QCliPrefixTrie trie;
+	};
+
+	QCommandLineParser::SingleDashWordOptionMode _singleDashWordOptionMode;
+	QSharedPointer<const OptionIndex> _builtinIndex;
+	QHash<const void*, QSharedPointer<const OptionIndex>> _optionIndexes;
+	QHash<const void*, QSharedPointer<const ChildIndex>> _childIndexes;
+
+	template <typename TNode>
+	QStringList completeNode(const TNode *node, const QStringList &words, int currentWord);
+	template <typename TNode>
+	QByteArray createIndexImpl(const TNode *root, const QFileInfo &program) const;
+
+	static void addOption(OptionIndex &index, const Option &option);
+	template <typename TNode>
+	QSharedPointer<const OptionIndex> enterNode(const TNode *node, const QSharedPointer<const OptionIndex> &parentIndex);
+	template <typename TNode>
+	QSharedPointer<const ChildIndex> childIndex(const TNode *node);
+
+	static Option toOption(const QCommandLineOption &option);
+	static QVector<Option> nodeOptions(const QCliNode *node);
+	static QVector<Option> nodeOptions(const QCliStaticNode *node);
+	static bool isContext(const QCliNode *node);
+	static bool isContext(const QCliStaticNode *node);
+	static bool isLazy(const QCliNode *node);
+	static bool isLazy(const QCliStaticNode *node);
+	static const QCliNode *findChild(const QCliNode *node, const QString &name);
+	static const QCliStaticNode *findChild(const QCliStaticNode *node, const QString &name);
+	static QVector<Candidate> children(const QCliNode *node);
+	static QVector<Candidate> children(const QCliStaticNode *node);
+	static QString defaultChild(const QCliNode *node);
+	static QString defaultChild(const QCliStaticNode *node);
+	static QStringList positionalHints(const QCliNode *node);
+	static QStringList positionalHints(const QCliStaticNode *node);
+
+	int valueOption(const OptionIndex &index, const QString &word, bool &inlineValue) const;
+	static QStringList optionCandidates(const OptionIndex &index, const QString &prefix);
+	static QStringList childCandidates(const ChildIndex &index, const QString &prefix);
+	static QString candidateLine(const QString &name, const QString &description);
+	static QString filesLine(const QString &hint);
+};
+
+#endif // QCLICOMPLETER_P_H
@@ -0,0 +1,74 @@
+#ifndef QCLICOMPLETIONINDEX_H
+#define QCLICOMPLETIONINDEX_H
+
+#include <stdint.h>
+
+/* Layout of the completion index written by QCliParser::writeCompletionIndex. Plain C, so that
+ * resolvers can use it without Qt. The file is meant to be mapped as is: all integers are in host
+ * byte order, all strings are NUL-terminated UTF-8 and referenced by their offset into the string
+ * table (offset 0 is the empty string). Nodes are stored breadth first, so the children of a node
+ * are contiguous, and they are sorted byte-wise by name. A prefix query is thus a binary search
+ * over the children. Options are stored per node in registration order, the builtin options
+ * first at the root node. The header also records the application binary the index was created
+ * by, so resolvers can detect an index that is older than the application. */
+
+#define QCLI_INDEX_MAGIC "QCLIIDX"
+#define QCLI_INDEX_VERSION 2u
+#define QCLI_INDEX_NONE 0xFFFFFFFFu
+
+enum {
+	/* header flags */
+	QCliIndexLongOptions = 0x01, /* QCommandLineParser::ParseAsLongOptions */
+
+	/* node flags */
+	QCliIndexContext = 0x01,
+	QCliIndexLazy = 0x02, /* children are only known at runtime - ask the application */
+
+	/* node and option flags */
+	QCliIndexHidden = 0x04,
+
+	/* option flags */
+	QCliIndexTakesValue = 0x08
+};
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+	uint64_t schemaHash;
+	uint32_t nodeCount;
+	uint32_t nodeOffset;
+	uint32_t optionCount;
+	uint32_t optionOffset;
+	uint32_t nameCount;
+	uint32_t nameOffset;
+	uint32_t stringSize;
+	uint32_t stringOffset;
+	uint32_t program; /* string offset of the absolute path of the application binary, 0 if unknown */
+	uint32_t reserved;
+	int64_t programModified; /* modification time of the binary, in seconds since the epoch */
+	uint64_t programSize;
+} QCliIndexHeader;
+
+typedef struct {
+	uint32_t name;
+	uint32_t description;
+	uint32_t flags;
+	uint32_t firstChild; /* node index */
+	uint32_t childCount;
+	uint32_t defaultChild; /* node index or QCLI_INDEX_NONE */
+	uint32_t firstOption; /* option index */
+	uint32_t optionCount;
+	uint32_t firstPositional; /* name index of the positional syntax strings */
+	uint32_t positionalCount;
+} QCliIndexNode;
+
+typedef struct {
+	uint32_t firstName; /* name index */
+	uint32_t nameCount;
+	uint32_t description;
+	uint32_t valueName;
+	uint32_t flags;
+} QCliIndexOption;
+
+#endif /* QCLICOMPLETIONINDEX_H */
@@ -0,0 +1,107 @@
+#include "qclidescriptioncatalog_p.h"
+#include <QtCore/QFile>
+#include <algorithm>
+
+QCliDescriptionCatalog::QCliDescriptionCatalog() :
+	_descriptions()
+{}
+
+QSharedPointer<const QCliDescriptionCatalog> QCliDescriptionCatalog::load(const QString &fileNamePattern, const QLocale &locale)
+{
+	QStringList fileNames;
+	if(fileNamePattern.contains(QStringLiteral("%1"))) {
+		const auto name = locale.name();
+		fileNames.append(fileNamePattern.arg(name));
+		fileNames.append(fileNamePattern.arg(name.section(QLatin1Char('_'), 0, 0)));
+	} else
+		fileNames.append(fileNamePattern);
+
+	for(const auto &fileName : fileNames) {
+		QFile file{fileName};
+		if(!file.open(QIODevice::ReadOnly))
+			continue;
+		QSharedPointer<QCliDescriptionCatalog> catalog{new QCliDescriptionCatalog{}};
+		if(catalog->parse(file.readAll()))
+			return catalog;
+	}
+	return {};
+}
+
+QByteArray QCliDescriptionCatalog::serialize(const QHash<QString, QString> &descriptions)
+{
+	// one "key<TAB>description" line per entry, with escaped line breaks. Sorted for reproducible files
+	auto keys = descriptions.keys();
+	std::sort(keys.begin(), keys.end());
+	QByteArray data;
+	for(const auto &key : keys) {
+		auto description = descriptions[key];
+		description.replace(QLatin1Char('\\'), QStringLiteral("\\\\"))
+				.replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+		data += key.toUtf8() + '\t' + description.toUtf8() + '\n';
+	}
+	return qCompress(data, 9);
+}
+
+QString QCliDescriptionCatalog::key(const QStringList &path, const QString &element)
+{
+	auto key = path.join(QLatin1Char(' '));
+	if(!key.isEmpty() && !element.isEmpty())
+		key += QLatin1Char(' ');
+	return key + element;
+}
+
+QString QCliDescriptionCatalog::optionKey(const QStringList &path, const QString &optionName)
+{
+	return key(path, QStringLiteral("--") + optionName);
+}
+
+QString QCliDescriptionCatalog::positionalKey(const QStringList &path, const QString &positionalName)
+{
+	return key(path, QLatin1Char('<') + positionalName + QLatin1Char('>'));
+}
+
+bool QCliDescriptionCatalog::contains(const QString &key) const
+{
+	return _descriptions.contains(key);
+}
+
+QString QCliDescriptionCatalog::description(const QString &key, const QString &fallback) const
+{
+	return _descriptions.value(key, fallback);
+}
+
+QString QCliDescriptionCatalog::optionDescription(const QStringList &path, const QString &optionName, const QString &fallback) const
+{
+	// like the parser, the outermost context wins: options of child nodes with a known name are skipped
+	for(auto depth = 0; depth <= path.size(); depth++) {
+		const auto it = _descriptions.constFind(optionKey(path.mid(0, depth), optionName));
+		if(it != _descriptions.constEnd())
+			return *it;
+	}
+	return fallback;
+}
+
+bool QCliDescriptionCatalog::parse(const QByteArray &compressedData)
+{
+	const auto data = qUncompress(compressedData);
+	if(data.isEmpty())
+		return false;
+
+	for(const auto &line : data.split('\n')) {
+		const auto separator = line.indexOf('\t');
+		if(separator == -1)
+			continue;
+		const auto escaped = QString::fromUtf8(line.constData() + separator + 1, line.size() - separator - 1);
+		QString description;
+		description.reserve(escaped.size());
+		for(auto i = 0; i < escaped.size(); i++) {
+			if(escaped[i] == QLatin1Char('\\') && i + 1 < escaped.size()) {
+				++i;
+				description.append(escaped[i] == QLatin1Char('n') ? QLatin1Char('\n') : escaped[i]);
+			} else
+				description.append(escaped[i]);
+		}
+		_descriptions.insert(QString::fromUtf8(line.constData(), separator), description);
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#ifndef QCLIDESCRIPTIONCATALOG_P_H
+#define QCLIDESCRIPTIONCATALOG_P_H
+
+#include <QtCore/QHash>
+#include <QtCore/QLocale>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+
+// Descriptions of nodes, options and positional arguments, stored outside of the tree in a
+// qCompress'ed file per language. Only loaded when help is shown. Entries are keyed by the context
+// path, followed by "--<option>" or "<positional>" for the elements of a node:
+//   ""                    application description
+//   "build test"          description of the "test" command in "build"
+//   "build --verbose"     option added to the "build" node
+//   "build test <file>"   positional argument of the "test" leaf
+class QCliDescriptionCatalog
+{
+public:
+	// fileNamePattern may contain a "%1", which is replaced by the locale name ("de_DE"), then by its language ("de")
+	static QSharedPointer<const QCliDescriptionCatalog> load(const QString &fileNamePattern, const QLocale &locale = {});
+	static QByteArray serialize(const QHash<QString, QString> &descriptions);
+
+	static QString key(const QStringList &path, const QString &element = {});
+	static QString optionKey(const QStringList &path, const QString &optionName);
+	static QString positionalKey(const QStringList &path, const QString &positionalName);
+
+	bool contains(const QString &key) const;
+	QString description(const QString &key, const QString &fallback = {}) const;
+	// searches the path and all its parents, as options are inherited by child nodes. Parents come
+	// first, because an option of a parent shadows options with the same name in its children
+	QString optionDescription(const QStringList &path, const QString &optionName, const QString &fallback = {}) const;
+
+private:
+	QHash<QString, QString> _descriptions;
+
+	QCliDescriptionCatalog();
+
+	bool parse(const QByteArray &compressedData);
+};
+
+#endif // QCLIDESCRIPTIONCATALOG_P_H
@@ -0,0 +1,183 @@
+#include "qclidispatch.h"
+#include "qcliparser.h"
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <algorithm>
+
+namespace {
+
+struct DispatchRegistry {
+	QMutex mutex;
+	QVector<QCliDispatchEntry> entries;
+};
+Q_GLOBAL_STATIC(DispatchRegistry, dispatchRegistry)
+
+bool entryLessThan(const QCliDispatchEntry &lhs, const QCliDispatchEntry &rhs)
+{
+	return qstrcmp(lhs.path, rhs.path) < 0;
+}
+
+}
+
+void QCliDispatch::registerTable(const QCliDispatchEntry *entries, int count)
+{
+	// usually there is only one table, so the merge is a plain copy
+	const auto registry = dispatchRegistry();
+	QMutexLocker locker{&registry->mutex};
+	QVector<QCliDispatchEntry> merged;
+	merged.reserve(registry->entries.size() + count);
+	std::merge(registry->entries.constBegin(), registry->entries.constEnd(),
+			   entries, entries + count,
+			   std::back_inserter(merged),
+			   entryLessThan);
+	registry->entries = merged;
+}
+
+QCliDispatchEntry QCliDispatch::find(const QStringList &contextChain)
+{
+	const auto registry = dispatchRegistry();
+	QMutexLocker locker{&registry->mutex};
+	if(registry->entries.isEmpty())
+		return {nullptr, nullptr, nullptr, nullptr};
+
+	const auto key = contextChain.join(QLatin1Char(' ')).toUtf8();
+	const QCliDispatchEntry keyEntry {key.constData(), nullptr, nullptr, nullptr};
+	const auto it = std::lower_bound(registry->entries.constBegin(), registry->entries.constEnd(), keyEntry, entryLessThan);
+	if(it != registry->entries.constEnd() && qstrcmp(it->path, key.constData()) == 0)
+		return *it;
+	else
+		return {nullptr, nullptr, nullptr, nullptr};
+}
+
+bool QCliDispatch::optionValues(const QCliParseResult &result, const char *name, QStringList &values)
+{
+	const auto index = result.optionIndex(QString::fromLatin1(name));
+	if(index == -1 || !result.isSetAt(index))
+		return false;
+	values = result.isTypedAt(index) ?
+				 result.typedStringsAt(index) :
+				 result.valuesAt(index);
+	return true;
+}
+
+bool QCliDispatch::optionValue(const QCliParseResult &result, const char *name, QVariant &value)
+{
+	const auto index = result.optionIndex(QString::fromLatin1(name));
+	if(index == -1 || !result.isSetAt(index))
+		return false;
+	const auto values = result.typedValuesAt(index);
+	value = values.isEmpty() ? QVariant{QString{}} : values.last();
+	return true;
+}
+
+bool QCliDispatch::optionFlag(const QCliParseResult &result, const char *name, bool &value)
+{
+	const auto index = result.optionIndex(QString::fromLatin1(name));
+	if(index == -1 || !result.isSetAt(index))
+		return false;
+	value = result.flagAt(index);
+	return true;
+}
+
+int QCliDispatch::argumentCountError(int minArgs, int maxArgs, int actual)
+{
+	auto message = QCliParser::tr("Expected ");
+	if(minArgs > 0)
+		message += QCliParser::tr("at least %L1 ").arg(minArgs);
+	if(maxArgs != -1) {
+		if(minArgs > 0)
+			message += QCliParser::tr("and ");
+		message += QCliParser::tr("at most %L1 ").arg(maxArgs);
+	}
+	message += QCliParser::tr("arguments, but %L1 have been passed!\n").arg(actual);
+	QCliParser::showParserMessage(message);
+	return EXIT_FAILURE;
+}
+
+int QCliDispatch::argumentError(int index, const char *typeName)
+{
+	QCliParser::showParserMessage(QCliParser::tr("Invalid positional argument at position %L1 "
+												 "- unable to convert input to %2\n")
+								  .arg(index)
+								  .arg(QString::fromLatin1(typeName)));
+	return EXIT_FAILURE;
+}
+
+int QCliDispatch::optionError(const char *name, const char *typeName)
+{
+	QCliParser::showParserMessage(QCliParser::tr("Invalid value for option %1 - unable to convert input to %2\n")
+								  .arg(QString::fromLatin1(name), QString::fromLatin1(typeName)));
+	return EXIT_FAILURE;
+}
+
+template <>
+bool QCliDispatch::convert<QString>(const QString &text, QString &value)
+{
+	value = text;
+	return true;
+}
+
+template <>
+bool QCliDispatch::convert<QByteArray>(const QString &text, QByteArray &value)
+{
+	value = text.toUtf8();
+	return true;
+}
+
+template <>
+bool QCliDispatch::convert<bool>(const QString &text, bool &value)
+{
+	// same rules as QVariant
+	value = !(text.isEmpty() ||
+			  text == QStringLiteral("0") ||
+			  text.compare(QStringLiteral("false"), Qt::CaseInsensitive) == 0);
+	return true;
+}
+
+template <>
+bool QCliDispatch::convert<int>(const QString &text, int &value)
+{
+	auto ok = false;
+	value = text.toInt(&ok);
+	return ok;
+}
+
+template <>
+bool QCliDispatch::convert<uint>(const QString &text, uint &value)
+{
+	auto ok = false;
+	value = text.toUInt(&ok);
+	return ok;
+}
+
+template <>
+bool QCliDispatch::convert<qint64>(const QString &text, qint64 &value)
+{
+	auto ok = false;
+	value = text.toLongLong(&ok);
+	return ok;
+}
+
+template <>
+bool QCliDispatch::convert<quint64>(const QString &text, quint64 &value)
+{
+	auto ok = false;
+	value = text.toULongLong(&ok);
+	return ok;
+}
+
+template <>
+bool QCliDispatch::convert<double>(const QString &text, double &value)
+{
+	auto ok = false;
+	value = text.toDouble(&ok);
+	return ok;
+}
+
+template <>
+bool QCliDispatch::convert<float>(const QString &text, float &value)
+{
+	auto ok = false;
+	value = text.toFloat(&ok);
+	return ok;
+}
@@ -0,0 +1,89 @@
+#ifndef QCLIDISPATCH_H
+#define QCLIDISPATCH_H
+
+#include "qcliparseresult.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QVariant>
+
+// Entry of a dispatch table generated by qcli-dispatchgen. The function creates the evaluator,
+// sets its options and calls the method for the context chain directly, without any reflection
+struct QCliDispatchEntry
+{
+	const char *path; // the context chain, joined by spaces
+	const QMetaObject *metaObject; // the evaluator the function creates
+	const char *method; // name of the called methods
+	int (*function)(const QCliParseResult &result, QObject *parent);
+};
+
+// Runtime support for the generated dispatch code. Tables register themselves at startup. A
+// QCliEvaluator with static dispatch enabled only uses an entry if it resolved the context chain to
+// the same evaluator class and method itself
+class Q_CLI_PARSER_EXPORT QCliDispatch
+{
+public:
+	// entries must be sorted by path
+	static void registerTable(const QCliDispatchEntry *entries, int count);
+	// a copy, as tables registered later move the entries. The function is null if there is no entry
+	static QCliDispatchEntry find(const QStringList &contextChain);
+
+	// false if the option is unknown in the context of the result or was not set. Options with a value
+	// type give the values the parser converted, the same ones QCliEvaluator passes on
+	static bool optionValues(const QCliParseResult &result, const char *name, QStringList &values);
+	static bool optionValue(const QCliParseResult &result, const char *name, QVariant &value);
+	static bool optionFlag(const QCliParseResult &result, const char *name, bool &value);
+
+	template <typename T>
+	static bool convert(const QVariant &value, T &result);
+	template <typename T>
+	static bool convert(const QString &text, T &value);
+
+	static int argumentCountError(int minArgs, int maxArgs, int actual);
+	static int argumentError(int index, const char *typeName);
+	static int optionError(const char *name, const char *typeName);
+};
+
+template <typename T>
+bool QCliDispatch::convert(const QVariant &value, T &result)
+{
+	// values without a value type are still strings
+	if(value.userType() == QMetaType::QString)
+		return convert(value.toString(), result);
+	auto variant = value;
+	if(!variant.convert(qMetaTypeId<T>()))
+		return false;
+	result = variant.value<T>();
+	return true;
+}
+
+template <typename T>
+bool QCliDispatch::convert(const QString &text, T &value)
+{
+	// any other type is converted like the evaluator does
+	QVariant variant{text};
+	if(!variant.convert(qMetaTypeId<T>()))
+		return false;
+	value = variant.value<T>();
+	return true;
+}
+
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<QString>(const QString &text, QString &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<QByteArray>(const QString &text, QByteArray &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<bool>(const QString &text, bool &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<int>(const QString &text, int &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<uint>(const QString &text, uint &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<qint64>(const QString &text, qint64 &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<quint64>(const QString &text, quint64 &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<double>(const QString &text, double &value);
+template <>
+Q_CLI_PARSER_EXPORT bool QCliDispatch::convert<float>(const QString &text, float &value);
+
+#endif // QCLIDISPATCH_H
@@ -1,7 +1,24 @@
 #include "qclievaluator.h"
+#include "qclidispatch.h"
+#include "qcliargumentlist_p.h"
 #include <QtCore/QMetaMethod>
 #include <QtCore/QDebug>
 #include <QtCore/QLoggingCategory>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QRunnable>
+#include <QtCore/QMutex>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+#include <cstdio>
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <functional>
 
 namespace {
 
@@ -11,35 +28,179 @@ constexpr auto LogScope = QtFatalMsg;
 constexpr auto LogScope = QtDebugMsg;
 #endif
 
+constexpr qint64 BatchChunkSize = 64 * 1024;
+
 Q_LOGGING_CATEGORY(cliEval, "QCliEvaluator", LogScope)
 
-auto logFilterEnabled = false;
-QLoggingCategory::CategoryFilter oldCategoryFilter = nullptr;
-QLoggingCategory *dCat = nullptr;
+// blocking is per thread, so evaluators in other threads still get their warnings
+thread_local auto logBlockCount = 0;
+std::once_flag messageHandlerFlag;
+QtMessageHandler oldMessageHandler = nullptr;
+
+// the invocation of the asynchronous method that is currently being called on this thread
+thread_local const QCliInvocation *activeInvocation = nullptr;
+
+std::array<QGenericArgument, 10> genericArguments(const QVariantList &arguments)
+{
+	// the arguments already have the parameter types
+	std::array<QGenericArgument, 10> args;
+	for (auto i = 0; i < arguments.size(); ++i) {
+		const auto &val = arguments[i];
+		args[static_cast<size_t>(i)] = QGenericArgument{val.typeName(), val.constData()};
+	}
+	return args;
+}
+
+QFuture<int> finishedFuture(int exitCode)
+{
+	QFutureInterface<int> futureInterface;
+	futureInterface.reportStarted();
+	futureInterface.reportResult(exitCode);
+	futureInterface.reportFinished();
+	return futureInterface.future();
+}
+
+int futureExitCode(const QFuture<int> &future)
+{
+	return future.isCanceled() || future.resultCount() == 0 ?
+				EXIT_FAILURE :
+				future.result();
+}
+
+// Every worker owns a queue of item indexes. A worker processes its own queue from the front, and
+// once it is empty, steals items from the back of the queues of the other workers
+class BatchScheduler
+{
+public:
+	BatchScheduler(int itemCount, int workerCount) :
+		_queues(static_cast<size_t>(workerCount))
+	{
+		for (auto worker = 0; worker < workerCount; ++worker) {
+			const auto begin = static_cast<qint64>(itemCount) * worker / workerCount;
+			const auto end = static_cast<qint64>(itemCount) * (worker + 1) / workerCount;
+			for (auto index = begin; index < end; ++index)
+				_queues[static_cast<size_t>(worker)].items.push_back(static_cast<int>(index));
+		}
+	}
+
+	bool take(int worker, int &index)
+	{
+		{
+			auto &queue = _queues[static_cast<size_t>(worker)];
+			std::lock_guard<std::mutex> lock{queue.mutex};
+			if (!queue.items.empty()) {
+				index = queue.items.front();
+				queue.items.pop_front();
+				return true;
+			}
+		}
+
+		const auto queueCount = static_cast<int>(_queues.size());
+		for (auto offset = 1; offset < queueCount; ++offset) {
+			auto &queue = _queues[static_cast<size_t>((worker + offset) % queueCount)];
+			std::lock_guard<std::mutex> lock{queue.mutex};
+			if (!queue.items.empty()) {
+				index = queue.items.back();
+				queue.items.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<int> items;
+	};
 
-void cliLogFilter(QLoggingCategory *category)
+	std::vector<Queue> _queues;
+};
+
+class FunctionRunnable : public QRunnable
 {
-	oldCategoryFilter(category);
-	if (qstrcmp(category->categoryName(), "default") == 0) {
-		dCat = category;
-		category->setEnabled(QtWarningMsg, !logFilterEnabled);
+public:
+	explicit FunctionRunnable(std::function<void()> function) :
+		_function{std::move(function)}
+	{}
+
+	void run() override {
+		_function();
 	}
+
+private:
+	std::function<void()> _function;
+};
+
+void cliMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+	if (logBlockCount > 0 &&
+		type == QtWarningMsg &&
+		qstrcmp(context.category, "default") == 0)
+		return;
+
+	if (oldMessageHandler)
+		oldMessageHandler(type, context, message);
+	else
+		fputs(qPrintable(qFormatLogMessage(type, context, message) + QLatin1Char('\n')), stderr);
 }
 
 }
 
+QCliInvocation::QCliInvocation() :
+	_valid(false),
+	_deadline(QDeadlineTimer::Forever),
+	_interface()
+{}
+
+bool QCliInvocation::isValid() const
+{
+	return _valid;
+}
+
+bool QCliInvocation::isCanceled() const
+{
+	return _valid && (_interface.isCanceled() || _deadline.hasExpired());
+}
+
+QDeadlineTimer QCliInvocation::deadline() const
+{
+	return _deadline;
+}
+
+QFuture<int> QCliInvocation::future() const
+{
+	return _interface.future();
+}
+
+
+
 QCliEvaluator::QCliEvaluator(QObject *parent) :
 	QObject{parent}
 {
-	if (!oldCategoryFilter)
-		oldCategoryFilter = QLoggingCategory::installFilter(cliLogFilter);
+	std::call_once(messageHandlerFlag, []() {
+		oldMessageHandler = qInstallMessageHandler(cliMessageHandler);
+	});
 }
 
+QCliEvaluator::~QCliEvaluator() = default;
+
 bool QCliEvaluator::doesAutoResolveObjects() const
 {
 	return _autoResolveObjects;
 }
 
+bool QCliEvaluator::isStaticDispatchEnabled() const
+{
+	return _staticDispatch;
+}
+
+QCliEvaluator::InstancePolicy QCliEvaluator::instancePolicy(const QMetaObject *metaObject) const
+{
+	const auto pool = _instancePools.value(metaObject);
+	return pool ? pool->policy : PerCallInstance;
+}
+
 int QCliEvaluator::exec(const QCliParser &parser)
 {
 	return execImpl(parser, parser.contextChain());
@@ -50,6 +211,156 @@ int QCliEvaluator::exec(const QCommandLineParser &parser)
 	return execImpl(parser, {});
 }
 
+int QCliEvaluator::exec(const QCliParseResult &result)
+{
+	return execImpl(result, result.contextChain());
+}
+
+QFuture<int> QCliEvaluator::execAsync(const QCliParser &parser, QDeadlineTimer deadline)
+{
+	return execAsyncImpl(parser, parser.contextChain(), deadline);
+}
+
+QFuture<int> QCliEvaluator::execAsync(const QCliParseResult &result, QDeadlineTimer deadline)
+{
+	return execAsyncImpl(result, result.contextChain(), deadline);
+}
+
+QCliInvocation QCliEvaluator::currentInvocation()
+{
+	return activeInvocation ? *activeInvocation : QCliInvocation{};
+}
+
+int QCliEvaluator::execBatch(QCliParser &parser)
+{
+	// evaluate the batch options of a parser that was processed with QCliParser::addBatchOption
+	const auto fileName = parser.value(QStringLiteral("batch"));
+	const auto separator = parser.isBuiltinSet(QStringLiteral("batch-null")) ? '\0' : '\n';
+
+	QFile file;
+	auto opened = false;
+	if (fileName == QStringLiteral("-"))
+		opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered);
+	else {
+		file.setFileName(fileName);
+		opened = file.open(QIODevice::ReadOnly);
+	}
+	if (!opened) {
+		QCliParser::showParserMessage(tr("Failed to open batch file \"%1\" with error: %2\n")
+									  .arg(fileName, file.errorString()));
+		return EXIT_FAILURE;
+	}
+
+	const auto results = execBatch(parser, &file, separator);
+	auto result = EXIT_SUCCESS;
+	for (auto i = 0; i < results.size(); ++i) {
+		if (results[i] != EXIT_SUCCESS) {
+			QCliParser::showParserMessage(tr("Batch command %L1 failed with exit code %2\n")
+										  .arg(i + 1)
+										  .arg(results[i]));
+			result = EXIT_FAILURE;
+		}
+	}
+	return result;
+}
+
+QVector<int> QCliEvaluator::execBatch(QCliParser &parser, QIODevice *device, char separator)
+{
+	// read the device in chunks and execute every command line as soon as it is complete. Every line parses
+	// into the parser, so the result of the caller is restored afterwards
+	const auto callerResult = parser._result;
+	QVector<int> results;
+	QByteArray buffer;
+	const auto execRecord = [&](QByteArray record) {
+		if (separator == '\n' && record.endsWith('\r'))
+			record.chop(1);
+		const auto commandLine = QString::fromUtf8(record);
+		// blank lines succeed without doing anything, so the results stay numbered like the lines
+		if (commandLine.trimmed().isEmpty())
+			results.append(EXIT_SUCCESS);
+		else
+			results.append(execBatchLine(parser, commandLine));
+	};
+
+	Q_FOREVER {
+		const auto chunk = device->read(BatchChunkSize);
+		if (chunk.isEmpty()) {
+			if (device->waitForReadyRead(-1))
+				continue;
+			else
+				break;
+		}
+
+		buffer.append(chunk);
+		auto begin = 0;
+		for (auto end = buffer.indexOf(separator); end != -1; end = buffer.indexOf(separator, begin)) {
+			execRecord(buffer.mid(begin, end - begin));
+			begin = end + 1;
+		}
+		buffer.remove(0, begin);
+	}
+	if (!buffer.isEmpty())
+		execRecord(buffer);
+
+	parser._result = callerResult;
+	return results;
+}
+
+QVector<QCliEvaluator::BatchResult> QCliEvaluator::execBatch(const QList<QCliParseResult> &results, int concurrency, BatchOrder order)
+{
+	// resolve all plans on this thread, so the workers only read shared data
+	QVector<DispatchPlan> plans;
+	plans.reserve(results.size());
+	for (const auto &result : results)
+		plans.append(result.isValid() ? dispatchPlan(result.contextChain()) : DispatchPlan{});
+
+	if (concurrency <= 0)
+		concurrency = QThread::idealThreadCount();
+	const auto workerCount = std::max(1, std::min(concurrency, results.size()));
+
+	QVector<BatchResult> batchResults;
+	batchResults.resize(order == OrderedResults ? results.size() : 0);
+	batchResults.reserve(results.size());
+	QMutex resultMutex;
+	BatchScheduler scheduler{results.size(), workerCount};
+	const auto runWorker = [&](int worker) {
+		auto index = -1;
+		while (scheduler.take(worker, index)) {
+			const auto &result = results[index];
+			auto exitCode = EXIT_FAILURE;
+			if (!result.isValid())
+				QCliParser::showParserMessage(result.errorText() + QLatin1Char('\n'));
+			else if (!plans[index].metaObject)
+				qCCritical(cliEval) << "Unable to find any evaluators capable of executing" << result.contextChain();
+			else // evaluators are created on the worker thread, so they cannot have a parent
+				exitCode = tryExec(plans[index], result, nullptr);
+
+			if (order == OrderedResults)
+				batchResults[index] = {index, exitCode};
+			else {
+				QMutexLocker locker{&resultMutex};
+				batchResults.append({index, exitCode});
+			}
+		}
+	};
+
+	if (workerCount == 1)
+		runWorker(0);
+	else {
+		if (!_batchPool) {
+			_batchPool = new QThreadPool{this};
+			_batchPool->setExpiryTimeout(-1);
+		}
+		_batchPool->setMaxThreadCount(std::max(_batchPool->maxThreadCount(), workerCount));
+		for (auto worker = 0; worker < workerCount; ++worker)
+			_batchPool->start(new FunctionRunnable{[&runWorker, worker]() {
+				runWorker(worker);
+			}});
+		_batchPool->waitForDone();
+	}
+	return batchResults;
+}
+
 bool QCliEvaluator::registerEvaluator(const QByteArray &className, const QStringList &path)
 {
 	const auto mo = metaObjectForName(className);
@@ -58,24 +369,68 @@ bool QCliEvaluator::registerEvaluator(const QByteArray &className, const QString
 	return registerEvaluator(mo, path);
 }
 
+bool QCliEvaluator::registerEvaluator(const QByteArray &className, const QStringList &path, InstancePolicy policy)
+{
+	const auto mo = metaObjectForName(className);
+	if (!mo)
+		return false;
+	return registerEvaluator(mo, path, policy);
+}
+
 bool QCliEvaluator::registerEvaluator(const QMetaObject *metaObject, const QStringList &path)
 {
 	if (!metaObject->inherits(&QObject::staticMetaObject))
 		return false;
 
 	_evaluators[path] = metaObject; // TODO fails
+	_dispatchPlans.clear();
+	return true;
+}
+
+bool QCliEvaluator::registerEvaluator(const QMetaObject *metaObject, const QStringList &path, InstancePolicy policy)
+{
+	if (!registerEvaluator(metaObject, path))
+		return false;
+	setInstancePolicy(metaObject, policy);
 	return true;
 }
 
+void QCliEvaluator::setInstancePolicy(const QMetaObject *metaObject, InstancePolicy policy)
+{
+	if (instancePolicy(metaObject) == policy)
+		return;
+
+	// idle instances of the old pool are deleted with it, once no call uses it anymore
+	if (policy == PerCallInstance)
+		_instancePools.remove(metaObject);
+	else {
+		auto pool = QSharedPointer<InstancePool>::create();
+		pool->policy = policy;
+		pool->resetMethod = metaObject->indexOfMethod("qCliReset()");
+		_instancePools.insert(metaObject, pool);
+	}
+	_dispatchPlans.clear();
+}
+
 void QCliEvaluator::setAutoResolveObjects(bool autoResolveObjects)
 {
 	if (_autoResolveObjects == autoResolveObjects)
 		return;
 
 	_autoResolveObjects = autoResolveObjects;
+	_dispatchPlans.clear();
 	emit autoResolveObjectsChanged(_autoResolveObjects);
 }
 
+void QCliEvaluator::setStaticDispatchEnabled(bool staticDispatch)
+{
+	if (_staticDispatch == staticDispatch)
+		return;
+
+	_staticDispatch = staticDispatch;
+	emit staticDispatchChanged(_staticDispatch);
+}
+
 QByteArray QCliEvaluator::evaluatorClassName(const QStringList &contextList) const
 {
 	return contextList.isEmpty() ?
@@ -100,7 +455,23 @@ const QMetaObject *QCliEvaluator::metaObjectForName(const QByteArray &className)
 	return QMetaType::metaObjectForType(typeId);
 }
 
-int QCliEvaluator::execImpl(const QCommandLineParser &parser, const QStringList &contextList)
+const QMetaObject *QCliEvaluator::resolveMetaObject(const QByteArray &className)
+{
+	auto it = _resolvedObjects.find(className);
+	if (it == _resolvedObjects.end())
+		it = _resolvedObjects.insert(className, metaObjectForName(className));
+	return *it;
+}
+
+QCliEvaluator::DispatchPlan QCliEvaluator::dispatchPlan(const QStringList &contextList)
+{
+	auto it = _dispatchPlans.find(contextList);
+	if (it == _dispatchPlans.end())
+		it = _dispatchPlans.insert(contextList, createDispatchPlan(contextList));
+	return *it;
+}
+
+QCliEvaluator::DispatchPlan QCliEvaluator::createDispatchPlan(const QStringList &contextList)
 {
 	// find the evaluator node chain
 	auto pNode = _evaluators[contextList];
@@ -108,84 +479,233 @@ int QCliEvaluator::execImpl(const QCommandLineParser &parser, const QStringList
 		const auto depth = pNode.depth();
 		// first: check if explicit evaluator was set
 		if (pNode.hasValue()) {
-			const auto res = tryExec(*pNode, parser, contextList.mid(depth));
-			if (res)
-				return res.value();
+			auto plan = createDispatchPlan(*pNode, contextList.mid(depth));
+			if (plan.metaObject)
+				return plan;
 		}
 		// second: if allowed, try to auto-resolve
 		if(_autoResolveObjects) {
 			const auto evaluatorName = evaluatorClassName(contextList.mid(0, depth));
-			const auto metaObj = metaObjectForName(evaluatorName);
+			const auto metaObj = resolveMetaObject(evaluatorName);
 			if (metaObj) {
-				const auto res = tryExec(metaObj, parser, contextList.mid(depth));
-				if (res)
-					return res.value();
+				auto plan = createDispatchPlan(metaObj, contextList.mid(depth));
+				if (plan.metaObject)
+					return plan;
 			}
 		}
 	} while((pNode = pNode.parent()));
 	// no evaluator found...
-	qCCritical(cliEval) << "Unable to find any evaluators capable of executing" << contextList;
-	return EXIT_FAILURE;
+	return {};
 }
 
-std::optional<int> QCliEvaluator::tryExec(const QMetaObject *metaObject, const QCommandLineParser &parser, const QStringList &contextList)
+QCliEvaluator::DispatchPlan QCliEvaluator::createDispatchPlan(const QMetaObject *metaObject, const QStringList &contextList) const
 {
-	// find a method that matches the generated name and parameters
+	// find all methods that match the generated name and parameters
+	DispatchPlan plan;
+	const auto rangeType = qMetaTypeId<QCliPositionalRange>(); // registers the type name before it is looked up
 	const auto methodName = evaluatorMethodName(metaObject, contextList);
-	const auto &pArgs = parser.positionalArguments();
-	const auto argSize = pArgs.size();
-	auto pCountMinTotal = std::numeric_limits<int>::max();
-	auto pCountMaxTotal = 0;
 	for (auto mIdx = 0; mIdx < metaObject->methodCount(); ++mIdx) {
 		const auto method = metaObject->method(mIdx);
 		// skip non matching methods
 		if ((method.methodType() != QMetaMethod::Method &&
 			method.methodType() != QMetaMethod::Slot) ||  // slots are allowed, but still must have the int return type
 			method.access() != QMetaMethod::Public ||
-			method.returnType() != QMetaType::Int ||
+			(method.returnType() != QMetaType::Int && qstrcmp(method.typeName(), "QFuture<int>") != 0) ||
 			method.name() != methodName)
 			continue;
 
+		DispatchMethod dMethod;
+		dMethod.methodIndex = mIdx;
+		dMethod.async = method.returnType() != QMetaType::Int;
+		plan.hasAsyncMethods = plan.hasAsyncMethods || dMethod.async;
+		dMethod.parameterTypes.reserve(method.parameterCount());
+		for (auto pIdx = 0; pIdx < method.parameterCount(); ++pIdx)
+			dMethod.parameterTypes.append(method.parameterType(pIdx));
+
 		// find parameter count with any Args
-		auto pCount = method.parameterCount();
-		auto anyArgs = false;
-		if (pCount > 0) {
-			switch (method.parameterType(pCount - 1)) {
+		dMethod.argCount = dMethod.parameterTypes.size();
+		dMethod.listType = QMetaType::UnknownType;
+		if (dMethod.argCount > 0) {
+			const auto lastType = dMethod.parameterTypes.last();
+			switch (lastType) {
 			case QMetaType::QStringList:
 			case QMetaType::QByteArrayList:
 			case QMetaType::QVariantList:
-				anyArgs = true;
-				--pCount;
+				dMethod.listType = lastType;
+				--dMethod.argCount;
 				break;
 			default:
+				if (lastType == rangeType) {
+					dMethod.listType = lastType;
+					--dMethod.argCount;
+				}
 				break;
 			}
 		}
-		pCountMinTotal = std::min(pCountMinTotal, pCount);
-		pCountMaxTotal = std::max(pCountMaxTotal, anyArgs ? std::numeric_limits<int>::max() : pCount);
+		plan.minArgs = std::min(plan.minArgs, dMethod.argCount);
+		plan.maxArgs = std::max(plan.maxArgs, dMethod.listType != QMetaType::UnknownType ?
+										std::numeric_limits<int>::max() :
+										dMethod.argCount);
+		plan.methods.append(dMethod);
+	}
+
+	if (plan.methods.isEmpty())
+		return plan;
+	plan.metaObject = metaObject;
+	plan.methodName = methodName;
+	plan.pool = _instancePools.value(metaObject);
+
+	// the option names of all writable properties only need to be computed once per evaluator
+	for (auto pIdx = 1; pIdx < metaObject->propertyCount(); ++pIdx) {
+		const auto property = metaObject->property(pIdx);
+		if (!property.isWritable())
+			continue;
+		plan.properties.append(OptionProperty {
+			pIdx,
+			property.userType(),
+			QString::fromUtf8(property.name()).replace(QLatin1Char('_'), QLatin1Char('-'))
+		});
+	}
+	return plan;
+}
+
+int QCliEvaluator::execBatchLine(QCliParser &parser, const QString &commandLine)
+{
+	// same as QCliParser::process + exec, but without ever exiting the process
+	auto ok = false;
+	auto arguments = QCliParser::splitCommandLine(commandLine, &ok);
+	if (!ok) {
+		QCliParser::showParserMessage(tr("Unterminated quote in command line: %1\n").arg(commandLine));
+		return EXIT_FAILURE;
+	}
+	arguments.prepend(QCoreApplication::applicationName());
+
+	auto exitCode = EXIT_FAILURE;
+	if (!parser.tryProcess(arguments, exitCode))
+		return exitCode;
+	if (parser.isBuiltinSet(QStringLiteral("batch"))) {
+		QCliParser::showParserMessage(tr("Batch commands cannot start another batch\n"));
+		return EXIT_FAILURE;
+	}
+	return exec(parser);
+}
+
+int QCliEvaluator::execCommand(const QCommandLineParser &parser)
+{
+	return execImpl(CommandParser{parser}, {parser.positionalArguments().value(0)});
+}
+
+template <typename TParser>
+int QCliEvaluator::execImpl(const TParser &parser, const QStringList &contextList, AsyncCall *asyncCall)
+{
+	// copy (implicitly shared), as the evaluator may register new evaluators while executing
+	const auto plan = dispatchPlan(contextList);
+	if (plan.metaObject) {
+		// a generated function is only a shortcut for what the plan would call anyways. They only work on parse
+		// results and always create a new instance, so pooled evaluators are dispatched via their plan
+		const auto result = parseResult(parser);
+		if (_staticDispatch && result && !plan.pool && !plan.hasAsyncMethods) {
+			const auto entry = QCliDispatch::find(contextList);
+			if (entry.function &&
+				entry.metaObject == plan.metaObject &&
+				plan.methodName == entry.method)
+				return entry.function(*result, this);
+		}
+		return tryExec(plan, parser, this, asyncCall);
+	}
+	// no evaluator found...
+	qCCritical(cliEval) << "Unable to find any evaluators capable of executing" << contextList;
+	return EXIT_FAILURE;
+}
+
+template <typename TParser>
+QFuture<int> QCliEvaluator::execAsyncImpl(const TParser &parser, const QStringList &contextList, QDeadlineTimer deadline)
+{
+	AsyncCall call;
+	call.invocation._valid = true;
+	call.invocation._deadline = deadline;
+	auto callInterface = call.invocation._interface;
+	callInterface.reportStarted();
+	const auto future = callInterface.future();
+
+	const auto exitCode = execImpl(parser, contextList, &call);
+	if (!call.lease) { // synchronous method or failed before the method was called
+		callInterface.reportResult(exitCode);
+		callInterface.reportFinished();
+		return future;
+	}
+
+	// forward the cancellation by the caller or the deadline to the method, and its result to the caller
+	auto methodFuture = call.methodFuture;
+	const auto methodWatcher = new QFutureWatcher<int>{this};
+	const auto callWatcher = new QFutureWatcher<int>{methodWatcher};
+	// a canceled call is finished right away, even if the method still runs. Its instance lives until it finished
+	const auto cancelCall = [callInterface, methodFuture]() mutable {
+		callInterface.cancel();
+		callInterface.reportFinished();
+		methodFuture.cancel();
+	};
+	connect(callWatcher, &QFutureWatcherBase::canceled, methodWatcher, cancelCall);
+	if (!deadline.isForever()) {
+		const auto timer = new QTimer{methodWatcher};
+		timer->setSingleShot(true);
+		connect(timer, &QTimer::timeout, methodWatcher, cancelCall);
+		timer->start(static_cast<int>(std::min<qint64>(deadline.remainingTime(), std::numeric_limits<int>::max())));
+	}
+	connect(methodWatcher, &QFutureWatcherBase::finished, this, [callInterface, lease = call.lease, methodWatcher]() mutable {
+		if (!callInterface.isFinished()) {
+			callInterface.reportResult(futureExitCode(methodWatcher->future()));
+			callInterface.reportFinished();
+		}
+		lease.reset(); // deletes the instance or returns it to its pool
+		methodWatcher->deleteLater();
+	});
+	callWatcher->setFuture(future);
+	methodWatcher->setFuture(methodFuture);
+	return future;
+}
+
+template <typename TParser>
+int QCliEvaluator::tryExec(const DispatchPlan &plan, const TParser &parser, QObject *parent, AsyncCall *asyncCall)
+{
+	// find a method that matches the parameters
+	// arguments are converted one by one, only for the method that is called
+	const auto &arguments = positionalArguments(parser);
+	const auto argSize = arguments.positionalArgumentCount();
+	for (const auto &dMethod : plan.methods) {
+		const auto pCount = dMethod.argCount;
+		const auto anyArgs = dMethod.listType != QMetaType::UnknownType;
 
 		// check if pos args can be passed to this method
 		if (argSize < pCount ||
 			(!anyArgs && argSize > pCount))
 			continue;
 
-		// if acceptable -> convert params into variant list
+		// if acceptable -> convert params into variant list. Typed arguments were already converted by the parser
 		QVariantList varList;
 		varList.reserve(anyArgs ? pCount + 1 : pCount);
 		for (auto aIdx = 0; aIdx < pCount; ++aIdx)
-			varList.append(pArgs[aIdx]);
-		if (anyArgs && argSize > pCount) {
+			varList.append(arguments.typedPositionalArgument(aIdx));
+		if (dMethod.listType == qMetaTypeId<QCliPositionalRange>()) {
+			// no conversion at all - the method reads the arguments on demand, even if there are none
+			varList.append(QVariant::fromValue(arguments.positionalRange(pCount)));
+		} else if (anyArgs && argSize > pCount) {
 			QVariant listArg;
-			switch (method.parameterType(pCount)) {
+			switch (dMethod.listType) {
 			case QMetaType::QVariantList:
-			case QMetaType::QStringList:
-				listArg = QVariant::fromValue(pArgs.mid(pCount));
+			case QMetaType::QStringList: {
+				QStringList sList;
+				sList.reserve(argSize - pCount);
+				for (auto aIdx = pCount; aIdx < argSize; ++aIdx)
+					sList.append(arguments.positionalArgument(aIdx));
+				listArg = QVariant::fromValue(sList);
 				break;
+			}
 			case QMetaType::QByteArrayList: {
 				QByteArrayList baList;
 				baList.reserve(argSize - pCount);
-				for (const auto &arg : pArgs.mid(pCount))
-					baList.append(arg.toUtf8());
+				for (auto aIdx = pCount; aIdx < argSize; ++aIdx)
+					baList.append(arguments.positionalArgumentUtf8(aIdx));
 				listArg = QVariant::fromValue(baList);
 				break;
 			}
@@ -194,97 +714,200 @@ std::optional<int> QCliEvaluator::tryExec(const QMetaObject *metaObject, const Q
 			}
 			varList.append(listArg);
 		}
+		// convert before the instance exists, so invalid input never creates an evaluator
+		if (!convertArguments(varList, dMethod.parameterTypes))
+			return EXIT_FAILURE;
 
-		// create the object and call the method
-		QScopedPointer<QObject> instance {metaObject->newInstance(Q_ARG(QObject*, this))};
-		if (!instance) {
-			qCCritical(cliEval) << "Failed to create instance of class" << metaObject->className()
+		// create the object (or take it from the pool) and call the method
+		const auto lease = QSharedPointer<InstanceLease>::create(plan, parent);
+		if (lease->isBusy()) {
+			qCCritical(cliEval) << "The singleton instance of class" << plan.metaObject->className()
+								<< "is still busy with an asynchronous call";
+			return EXIT_FAILURE;
+		}
+		if (!lease->instance()) {
+			qCCritical(cliEval) << "Failed to create instance of class" << plan.metaObject->className()
 								<< "- make shure the constructor has the following signature: "
 								   "Q_INVOKABLE constructor(QObject*);";
 			return EXIT_FAILURE;
 		}
 		// set options
-		setOptionProperties(instance.data(), parser);
+		setOptionProperties(lease->instance(), plan, parser);
 		// call method with positional args
-		return callMetaMethod(instance.data(), method, varList);
+		const auto method = plan.metaObject->method(dMethod.methodIndex);
+		if (!dMethod.async)
+			return callMetaMethod(lease->instance(), method, varList);
+
+		const auto future = callAsyncMetaMethod(lease->instance(), method, varList,
+												asyncCall ? asyncCall->invocation : QCliInvocation{});
+		if (!asyncCall)
+			return waitForExitCode(future);
+		// the instance must outlive the future
+		lease->markAsync();
+		asyncCall->methodFuture = future;
+		asyncCall->lease = lease;
+		return EXIT_SUCCESS;
 	}
 
-	// no method found that matches the given name
-	if (pCountMinTotal == std::numeric_limits<int>::max())
-		return std::nullopt;
-	else { // method was found, but arguments do not match
-		auto message = tr("Expected ");
-		if (pCountMinTotal > 0)
-			message += tr("at least %L1 ").arg(pCountMinTotal);
-		if (pCountMaxTotal != std::numeric_limits<int>::max()) {
-			if (pCountMinTotal > 0)
-				message += tr("and ");
-			message += tr("at most %L1 ").arg(pCountMaxTotal);
-		}
-		message += tr("arguments, but %L1 have been passed!\n").arg(argSize);
-		QCliParser::showParserMessage(message);
-		return EXIT_FAILURE;
+	// method was found, but arguments do not match
+	auto message = tr("Expected ");
+	if (plan.minArgs > 0)
+		message += tr("at least %L1 ").arg(plan.minArgs);
+	if (plan.maxArgs != std::numeric_limits<int>::max()) {
+		if (plan.minArgs > 0)
+			message += tr("and ");
+		message += tr("at most %L1 ").arg(plan.maxArgs);
 	}
+	message += tr("arguments, but %L1 have been passed!\n").arg(argSize);
+	QCliParser::showParserMessage(message);
+	return EXIT_FAILURE;
 }
 
-void QCliEvaluator::setOptionProperties(QObject *instance, const QCommandLineParser &parser) const
+template <typename TParser>
+void QCliEvaluator::setOptionProperties(QObject *instance, const DispatchPlan &plan, const TParser &parser) const
 {
-	const auto metaObject = instance->metaObject();
-	for (auto i = 1; i < metaObject->propertyCount(); ++i) {
-		const auto property = metaObject->property(i);
-		if (!property.isWritable())
-			continue;
-		// is set -> update property
-		const auto pName = QString::fromUtf8(property.name()).replace(QLatin1Char('_'), QLatin1Char('-'));
-
-		auto isSet = false;
-		{
+	// cli results are looked up once per property, by index. QCommandLineParser only knows names
+	const auto result = parseResult(parser);
+	for (const auto &option : plan.properties) {
+		auto index = -1;
+		if (result) {
+			index = result->optionIndex(option.optionName);
+			if (index == -1 || !result->isSetAt(index))
+				continue;
+		} else {
 			LogBlocker blocker;
-			isSet = parser.isSet(pName);
+			if (!parser.isSet(option.optionName))
+				continue;
 		}
-		if(isSet) {
-			switch (property.userType()) {
-			case QMetaType::Bool:
-				property.write(instance, true);
-				break;
+		const auto pValues = [&]() {
+			return result ? result->valuesAt(index) : parser.values(option.optionName);
+		};
+
+		// is set -> update property
+		const auto property = plan.metaObject->property(option.propertyIndex);
+		if (result && result->isTypedAt(index)) {
+			// typed options were already converted by the parser
+			const auto valueList = result->typedValuesAt(index);
+			switch (option.userType) {
 			case QMetaType::QStringList:
+				property.write(instance, result->typedStringsAt(index));
+				break;
 			case QMetaType::QVariantList:
-				property.write(instance, parser.values(pName));
+				property.write(instance, valueList);
 				break;
 			case QMetaType::QByteArrayList: {
-				const auto pValues = parser.values(pName);
 				QByteArrayList baList;
-				baList.reserve(pValues.size());
-				for (const auto &arg : pValues)
-					baList.append(arg.toUtf8());
+				for (const auto &value : result->typedStringsAt(index))
+					baList.append(value.toUtf8());
 				property.write(instance, QVariant::fromValue(baList));
 				break;
 			}
 			default:
-				property.write(instance, parser.value(pName));
+				property.write(instance, valueList.isEmpty() ? QVariant{QString{}} : valueList.last());
 				break;
 			}
+			continue;
+		}
+
+		switch (option.userType) {
+		case QMetaType::Bool:
+			property.write(instance, true);
+			break;
+		case QMetaType::QStringList:
+		case QMetaType::QVariantList:
+			property.write(instance, pValues());
+			break;
+		case QMetaType::QByteArrayList: {
+			const auto valueList = pValues();
+			QByteArrayList baList;
+			baList.reserve(valueList.size());
+			for (const auto &arg : valueList)
+				baList.append(arg.toUtf8());
+			property.write(instance, QVariant::fromValue(baList));
+			break;
+		}
+		default: {
+			const auto valueList = pValues();
+			property.write(instance, valueList.isEmpty() ? QString{} : valueList.last());
+			break;
+		}
 		}
 	}
 }
 
-int QCliEvaluator::callMetaMethod(QObject *instance, const QMetaMethod &method, QVariantList arguments) const
+const QCliParseResult *QCliEvaluator::parseResult(const QCliParser &parser)
 {
-	Q_ASSERT_X(arguments.size() <= 10, Q_FUNC_INFO, "Trying to invoke methode with more then 10 arguments!");
+	return &parser._result;
+}
 
-	// prepare arguments
-	std::array<QGenericArgument, 10> args;
+const QCliParseResult *QCliEvaluator::parseResult(const QCliParseResult &result)
+{
+	return &result;
+}
+
+const QCliParseResult *QCliEvaluator::parseResult(const QCommandLineParser &parser)
+{
+	Q_UNUSED(parser)
+	return nullptr;
+}
+
+const QCliParseResult *QCliEvaluator::parseResult(const CommandParser &parser)
+{
+	Q_UNUSED(parser)
+	return nullptr;
+}
+
+const QCliParseResult &QCliEvaluator::positionalArguments(const QCliParser &parser)
+{
+	return parser._result;
+}
+
+const QCliParseResult &QCliEvaluator::positionalArguments(const QCliParseResult &result)
+{
+	return result;
+}
+
+QCliParseResult QCliEvaluator::positionalArguments(const QCommandLineParser &parser)
+{
+	return positionalArguments(parser.positionalArguments());
+}
+
+QCliParseResult QCliEvaluator::positionalArguments(const CommandParser &parser)
+{
+	// without the command itself
+	return positionalArguments(parser.parser.positionalArguments().mid(1));
+}
+
+QCliParseResult QCliEvaluator::positionalArguments(const QStringList &argumentList)
+{
+	QCliParseResult result;
+	result._valid = true;
+	result._arguments = QSharedPointer<const QCliArgumentList>{new QCliArgumentList{argumentList}};
+	result._positionalArguments.reserve(argumentList.size());
+	for (auto i = 0; i < argumentList.size(); ++i)
+		result._positionalArguments.append(QCliParseResult::Token{i, 0});
+	return result;
+}
+
+bool QCliEvaluator::convertArguments(QVariantList &arguments, const QVector<int> &parameterTypes)
+{
 	for (auto i = 0; i < arguments.size(); ++i) {
-		auto &val = arguments[i];
-		if (!val.convert(method.parameterType(i))) {
+		if (!arguments[i].convert(parameterTypes[i])) {
 			QCliParser::showParserMessage(tr("Invalid positional argument at position %L1 "
 											 "- unable to convert input to %2\n")
 										  .arg(i)
-										  .arg(QString::fromUtf8(QMetaType::typeName(method.parameterType(i)))));
-			return EXIT_FAILURE;
+										  .arg(QString::fromUtf8(QMetaType::typeName(parameterTypes[i]))));
+			return false;
 		}
-		args[static_cast<size_t>(i)] = QGenericArgument{val.typeName(), val.constData()};
 	}
+	return true;
+}
+
+int QCliEvaluator::callMetaMethod(QObject *instance, const QMetaMethod &method, const QVariantList &arguments) const
+{
+	Q_ASSERT_X(arguments.size() <= 10, Q_FUNC_INFO, "Trying to invoke methode with more then 10 arguments!");
+
+	const auto args = genericArguments(arguments);
 
 	int retVal = EXIT_FAILURE;
 	if (method.invoke(instance, Qt::DirectConnection,
@@ -300,17 +923,193 @@ int QCliEvaluator::callMetaMethod(QObject *instance, const QMetaMethod &method,
 }
 
 
+QFuture<int> QCliEvaluator::callAsyncMetaMethod(QObject *instance, const QMetaMethod &method, const QVariantList &arguments, const QCliInvocation &invocation) const
+{
+	Q_ASSERT_X(arguments.size() <= 10, Q_FUNC_INFO, "Trying to invoke methode with more then 10 arguments!");
+
+	const auto args = genericArguments(arguments);
+	// only visible while the method is called - it has to copy it to use it later
+	const auto previousInvocation = activeInvocation;
+	activeInvocation = &invocation;
+	QFuture<int> future;
+	const auto invoked = method.invoke(instance, Qt::DirectConnection,
+									   QReturnArgument<QFuture<int>>{"QFuture<int>", future},
+									   args[0], args[1], args[2], args[3], args[4],
+									   args[5], args[6], args[7], args[8], args[9]);
+	activeInvocation = previousInvocation;
+	if (invoked)
+		return future;
+	else {
+		qCCritical(cliEval) << "Failed to call method" << method.methodSignature()
+							<< "on instance" << instance;
+		return finishedFuture(EXIT_FAILURE);
+	}
+}
+
+int QCliEvaluator::waitForExitCode(const QFuture<int> &future)
+{
+	// the method may need the event loop of this thread to finish, so it keeps running while waiting
+	if (!future.isFinished()) {
+		QEventLoop loop;
+		QFutureWatcher<int> watcher;
+		connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+		watcher.setFuture(future);
+		loop.exec();
+	}
+	return futureExitCode(future);
+}
+
+
+
+bool QCliEvaluator::CommandParser::isSet(const QString &name) const
+{
+	return parser.isSet(name);
+}
+
+QStringList QCliEvaluator::CommandParser::values(const QString &name) const
+{
+	return parser.values(name);
+}
+
+
+
+QCliEvaluator::InstancePool::~InstancePool()
+{
+	// instances of other threads are deleted by them, at the latest when they finish
+	for (auto it = idle.constBegin(); it != idle.constEnd(); ++it) {
+		for (const auto &instance : *it) {
+			if (!it.key() || it.key() == QThread::currentThread())
+				delete instance.object;
+			else
+				instance.object->deleteLater();
+		}
+	}
+}
+
+void QCliEvaluator::InstancePool::releaseThread(const QWeakPointer<InstancePool> &pool, QThread *thread)
+{
+	// called on the finishing thread, which owns the instances
+	const auto strongPool = pool.toStrongRef();
+	if (!strongPool)
+		return;
+	QVector<Instance> instances;
+	{
+		QMutexLocker locker{&strongPool->mutex};
+		instances = strongPool->idle.take(thread);
+	}
+	for (const auto &instance : qAsConst(instances))
+		delete instance.object;
+}
+
+
+
+QCliEvaluator::InstanceLease::InstanceLease(const DispatchPlan &plan, QObject *parent) :
+	_plan{plan},
+	_instance{nullptr, {}},
+	_busy(false),
+	_ownsSingleton(false)
+{
+	const auto &pool = _plan.pool;
+	if (!pool) {
+		_instance.object = _plan.metaObject->newInstance(Q_ARG(QObject*, parent));
+		return;
+	}
+
+	{
+		QMutexLocker locker{&pool->mutex};
+		if (pool->policy == SingletonInstance) {
+			while (pool->busy && !pool->asyncBusy)
+				pool->released.wait(&pool->mutex);
+			if (pool->busy) {
+				_busy = true;
+				return;
+			}
+			pool->busy = true;
+			_ownsSingleton = true;
+		}
+		const auto thread = pool->policy == SingletonInstance ? nullptr : QThread::currentThread();
+		const auto it = pool->idle.find(thread);
+		if (it != pool->idle.end() && !it->isEmpty()) {
+			_instance = it->takeLast();
+			if (!thread)
+				_instance.object->moveToThread(QThread::currentThread());
+			return;
+		} else if (it == pool->idle.end()) {
+			pool->idle.insert(thread, {});
+			if (thread) {
+				const auto weakPool = pool.toWeakRef();
+				QObject::connect(thread, &QThread::finished, [weakPool, thread]() {
+					InstancePool::releaseThread(weakPool, thread);
+				});
+			}
+		}
+	}
+
+	// reused instances outlive the call, so they never get a parent
+	_instance.object = _plan.metaObject->newInstance(Q_ARG(QObject*, nullptr));
+	if (!_instance.object)
+		return;
+	_instance.defaults.reserve(_plan.properties.size());
+	for (const auto &option : _plan.properties)
+		_instance.defaults.append(_plan.metaObject->property(option.propertyIndex).read(_instance.object));
+}
+
+QCliEvaluator::InstanceLease::~InstanceLease()
+{
+	const auto &pool = _plan.pool;
+	if (!pool) {
+		delete _instance.object;
+		return;
+	}
+
+	if (_instance.object) {
+		// undo the options of this call, so the next one starts like with a new instance
+		for (auto i = 0; i < _plan.properties.size(); ++i)
+			_plan.metaObject->property(_plan.properties[i].propertyIndex).write(_instance.object, _instance.defaults[i]);
+		if (pool->resetMethod != -1)
+			_plan.metaObject->method(pool->resetMethod).invoke(_instance.object, Qt::DirectConnection);
+	}
+
+	if (_instance.object && pool->policy == SingletonInstance)
+		_instance.object->moveToThread(nullptr);
+	QMutexLocker locker{&pool->mutex};
+	if (_instance.object)
+		pool->idle[_instance.object->thread()].append(_instance);
+	if (_ownsSingleton) {
+		pool->busy = false;
+		pool->asyncBusy = false;
+		pool->released.wakeOne();
+	}
+}
+
+QObject *QCliEvaluator::InstanceLease::instance() const
+{
+	return _instance.object;
+}
+
+bool QCliEvaluator::InstanceLease::isBusy() const
+{
+	return _busy;
+}
+
+void QCliEvaluator::InstanceLease::markAsync()
+{
+	if (!_ownsSingleton)
+		return;
+	// calls that wait for the singleton now fail instead
+	QMutexLocker locker{&_plan.pool->mutex};
+	_plan.pool->asyncBusy = true;
+	_plan.pool->released.wakeAll();
+}
+
+
 
 QCliEvaluator::LogBlocker::LogBlocker()
 {
-	logFilterEnabled = true;
-	if (dCat)
-		dCat->setEnabled(QtWarningMsg, false);
+	++logBlockCount;
 }
 
 QCliEvaluator::LogBlocker::~LogBlocker()
 {
-	logFilterEnabled = false;
-	if (dCat)
-		dCat->setEnabled(QtWarningMsg, true);
+	--logBlockCount;
 }
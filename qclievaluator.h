@@ -6,59 +6,254 @@
 #include <QtCore/QObject>
 #include <QtCore/QHash>
 #include <QtCore/QVariant>
+#include <QtCore/QVector>
+#include <QtCore/QIODevice>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QFuture>
+#include <QtCore/QFutureInterface>
+#include <QtCore/QDeadlineTimer>
+#include <QtCore/QThreadPool>
+
+#include <limits>
 
 #include <qunorderedtree.h>
 
+// The deadline and cancellation state of a single QCliEvaluator::execAsync call. Asynchronous evaluator
+// methods get it via QCliEvaluator::currentInvocation while they are called, and can keep a copy to
+// check it from wherever their work continues. Invalid for synchronous calls
+class Q_CLI_PARSER_EXPORT QCliInvocation
+{
+public:
+	QCliInvocation();
+
+	bool isValid() const;
+	// canceled by the caller of execAsync, or the deadline expired
+	bool isCanceled() const;
+	QDeadlineTimer deadline() const;
+	// the future returned by execAsync, e.g. to watch for cancellation
+	QFuture<int> future() const;
+
+private:
+	friend class QCliEvaluator;
+
+	bool _valid;
+	QDeadlineTimer _deadline;
+	mutable QFutureInterface<int> _interface;
+};
+
 class Q_CLI_PARSER_EXPORT QCliEvaluator : public QObject
 {
 	Q_OBJECT
 
 	Q_PROPERTY(bool autoResolveObjects READ doesAutoResolveObjects WRITE setAutoResolveObjects NOTIFY autoResolveObjectsChanged)
+	Q_PROPERTY(bool staticDispatch READ isStaticDispatchEnabled WRITE setStaticDispatchEnabled NOTIFY staticDispatchChanged)
 
 public:
+	enum BatchOrder {
+		OrderedResults,
+		UnorderedResults
+	};
+	Q_ENUM(BatchOrder)
+
+	// how evaluator instances live. Pooled and singleton instances are reused: the option properties are
+	// restored to the values of a new instance after each call, and a "Q_INVOKABLE void qCliReset()"
+	// method is called if the evaluator has one
+	enum InstancePolicy {
+		PerCallInstance,
+		PooledInstance,
+		SingletonInstance
+	};
+	Q_ENUM(InstancePolicy)
+
+	struct BatchResult {
+		int index;
+		int exitCode;
+	};
+
 	explicit QCliEvaluator(QObject *parent = nullptr);
+	~QCliEvaluator() override;
 
+	// without a policy, the one set before for the class is kept (per call instances by default)
 	template <typename TEvaluator>
 	bool registerEvaluator(const QStringList &path);
+	template <typename TEvaluator>
+	bool registerEvaluator(const QStringList &path, InstancePolicy policy);
+
+	InstancePolicy instancePolicy(const QMetaObject *metaObject) const;
 
 	bool doesAutoResolveObjects() const;
+	bool isStaticDispatchEnabled() const;
 
 	Q_INVOKABLE int exec(const QCliParser &parser);
 	Q_INVOKABLE int exec(const QCommandLineParser &parser);
+	Q_INVOKABLE int exec(const QCliParseResult &result);
+	// methods can also return a QFuture<int>. exec waits for it with a local event loop, while execAsync
+	// returns right away. It must be called from a thread with a running event loop
+	QFuture<int> execAsync(const QCliParser &parser, QDeadlineTimer deadline = QDeadlineTimer{QDeadlineTimer::Forever});
+	QFuture<int> execAsync(const QCliParseResult &result, QDeadlineTimer deadline = QDeadlineTimer{QDeadlineTimer::Forever});
+	static QCliInvocation currentInvocation();
+
+	int execBatch(QCliParser &parser);
+	// one exit code per line, blank ones included. The parse result of the parser is the same afterwards
+	QVector<int> execBatch(QCliParser &parser, QIODevice *device, char separator = '\n');
+	QVector<BatchResult> execBatch(const QList<QCliParseResult> &results, int concurrency = 0, BatchOrder order = OrderedResults);
 
 public Q_SLOTS:
 	bool registerEvaluator(const QByteArray &className, const QStringList &path);
+	bool registerEvaluator(const QByteArray &className, const QStringList &path, InstancePolicy policy);
 	bool registerEvaluator(const QMetaObject *metaObject, const QStringList &path);
+	bool registerEvaluator(const QMetaObject *metaObject, const QStringList &path, InstancePolicy policy);
+	void setInstancePolicy(const QMetaObject *metaObject, InstancePolicy policy);
 
 	void setAutoResolveObjects(bool autoResolveObjects);
+	void setStaticDispatchEnabled(bool staticDispatch);
 
 signals:
 	void autoResolveObjectsChanged(bool autoResolveObjects);
+	void staticDispatchChanged(bool staticDispatch);
 
 protected:
 	virtual QByteArray evaluatorClassName(const QStringList &contextList) const;
 	virtual QByteArray evaluatorMethodName(const QMetaObject *metaObject, const QStringList &contextList) const;
 
 private:
+	friend class QCliGenerator;
+
 	struct LogBlocker {
 		LogBlocker();
 		~LogBlocker();
 	};
 
+	struct DispatchMethod {
+		int methodIndex;
+		int argCount; // without the list of additional arguments
+		int listType; // type of the additional arguments list, or QMetaType::UnknownType
+		bool async; // returns a QFuture<int>
+		QVector<int> parameterTypes;
+	};
+
+	struct OptionProperty {
+		int propertyIndex;
+		int userType;
+		QString optionName; // the property name, with '_' replaced by '-'
+	};
+
+	// idle instances of a pooled or singleton evaluator, with the property values they were created with.
+	// Pooled instances stay on the thread that created them, as they may hold per thread resources like
+	// database connections, and are deleted once it finishes. An idle singleton has no thread affinity
+	// (key nullptr), and every call pulls it onto its own thread
+	struct InstancePool {
+		struct Instance {
+			QObject *object;
+			QVariantList defaults;
+		};
+
+		InstancePolicy policy = PooledInstance;
+		int resetMethod = -1;
+		QMutex mutex;
+		QHash<QThread*, QVector<Instance>> idle;
+		// singletons handle one call at a time. Calls wait for synchronous ones, but never for asynchronous
+		// ones, which might need the waiting thread to finish
+		bool busy = false;
+		bool asyncBusy = false;
+		QWaitCondition released;
+
+		~InstancePool();
+		static void releaseThread(const QWeakPointer<InstancePool> &pool, QThread *thread);
+	};
+
+	struct DispatchPlan {
+		const QMetaObject *metaObject = nullptr;
+		QByteArray methodName;
+		bool hasAsyncMethods = false; // generated dispatch functions only call synchronous ones
+		QSharedPointer<InstancePool> pool; // not set for per call instances
+		QVector<DispatchMethod> methods;
+		QVector<OptionProperty> properties;
+		int minArgs = std::numeric_limits<int>::max();
+		int maxArgs = 0;
+	};
+
+	// an evaluator instance for a single call. Per call instances are deleted afterwards, and
+	// pooled ones are reset and returned to their pool
+	class InstanceLease {
+		Q_DISABLE_COPY(InstanceLease)
+	public:
+		InstanceLease(const DispatchPlan &plan, QObject *parent);
+		~InstanceLease();
+
+		QObject *instance() const;
+		bool isBusy() const;
+		void markAsync();
+
+	private:
+		const DispatchPlan _plan;
+		InstancePool::Instance _instance;
+		bool _busy;
+		bool _ownsSingleton;
+	};
+
+	// state of an execAsync call while the evaluator method is called
+	struct AsyncCall {
+		QCliInvocation invocation;
+		QFuture<int> methodFuture;
+		QSharedPointer<InstanceLease> lease; // only set if the method returned a future. Ends once it finished
+	};
+
+	// a plain parser whose first positional argument selects the command, as used by QCliGenerator
+	struct CommandParser {
+		const QCommandLineParser &parser;
+
+		bool isSet(const QString &name) const;
+		QStringList values(const QString &name) const;
+	};
+
 	using EvaluatorTree = QUnorderedTree<QString, const QMetaObject *>;
 
 	bool _autoResolveObjects = true;
+	// use the tables generated by qcli-dispatchgen (see qclidispatch.h) before any reflection
+	bool _staticDispatch = true;
 
 	EvaluatorTree _evaluators;
+	QHash<QStringList, DispatchPlan> _dispatchPlans;
+	QHash<QByteArray, const QMetaObject*> _resolvedObjects;
+	QHash<const QMetaObject*, QSharedPointer<InstancePool>> _instancePools;
+	// workers of execBatch. They are kept, so pooled instances created on them are reused by later batches
+	QThreadPool *_batchPool = nullptr;
 
 	static const QMetaObject *metaObjectForName(const QByteArray &className);
+	const QMetaObject *resolveMetaObject(const QByteArray &className);
+
+	DispatchPlan dispatchPlan(const QStringList &contextList);
+	DispatchPlan createDispatchPlan(const QStringList &contextList);
+	DispatchPlan createDispatchPlan(const QMetaObject *metaObject, const QStringList &contextList) const;
+
+	int execBatchLine(QCliParser &parser, const QString &commandLine);
+	int execCommand(const QCommandLineParser &parser);
 
-	int execImpl(const QCommandLineParser &parser, const QStringList &contextList);
-	std::optional<int> tryExec(const QMetaObject *metaObject,
-							   const QCommandLineParser &parser,
-							   const QStringList &contextList);
-	void setOptionProperties(QObject *instance, const QCommandLineParser &parser) const;
-	int callMetaMethod(QObject *instance, const QMetaMethod &method, QVariantList arguments) const;
+	template <typename TParser>
+	int execImpl(const TParser &parser, const QStringList &contextList, AsyncCall *asyncCall = nullptr);
+	template <typename TParser>
+	QFuture<int> execAsyncImpl(const TParser &parser, const QStringList &contextList, QDeadlineTimer deadline);
+	template <typename TParser>
+	int tryExec(const DispatchPlan &plan, const TParser &parser, QObject *parent, AsyncCall *asyncCall = nullptr);
+	template <typename TParser>
+	void setOptionProperties(QObject *instance, const DispatchPlan &plan, const TParser &parser) const;
+	static const QCliParseResult *parseResult(const QCliParser &parser);
+	static const QCliParseResult *parseResult(const QCliParseResult &result);
+	static const QCliParseResult *parseResult(const QCommandLineParser &parser);
+	static const QCliParseResult *parseResult(const CommandParser &parser);
+	// the positional arguments, with indexed access. Collected once for QCommandLineParsers, which only have a list
+	static const QCliParseResult &positionalArguments(const QCliParser &parser);
+	static const QCliParseResult &positionalArguments(const QCliParseResult &result);
+	static QCliParseResult positionalArguments(const QCommandLineParser &parser);
+	static QCliParseResult positionalArguments(const CommandParser &parser);
+	static QCliParseResult positionalArguments(const QStringList &argumentList);
+	static bool convertArguments(QVariantList &arguments, const QVector<int> &parameterTypes);
+	int callMetaMethod(QObject *instance, const QMetaMethod &method, const QVariantList &arguments) const;
+	QFuture<int> callAsyncMetaMethod(QObject *instance, const QMetaMethod &method, const QVariantList &arguments, const QCliInvocation &invocation) const;
+	static int waitForExitCode(const QFuture<int> &future);
 };
 
 template<typename TEvaluator>
@@ -68,4 +263,11 @@ bool QCliEvaluator::registerEvaluator(const QStringList &path)
 	return registerEvaluator(&TEvaluator::staticMetaObject, path);
 }
 
+template<typename TEvaluator>
+bool QCliEvaluator::registerEvaluator(const QStringList &path, InstancePolicy policy)
+{
+	static_assert(std::is_base_of_v<QObject, TEvaluator>, "TEvaluator must extend QObject!");
+	return registerEvaluator(&TEvaluator::staticMetaObject, path, policy);
+}
+
 #endif // QCLIEVALUATOR_H
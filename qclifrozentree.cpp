@@ -0,0 +1,210 @@
+#include "qclifrozentree_p.h"
+#include <QtCore/QHash>
+#include <algorithm>
+#include <numeric>
+
+QCliFrozenTree::QCliFrozenTree(const QCliContext *root, const QList<QCommandLineOption> &builtinOptions) :
+	_nodes(),
+	_options(),
+	_localOptions(),
+	_childEntries(),
+	_optionEntries(),
+	_displacements()
+{
+	addNode(root, builtinOptions.toVector());
+}
+
+const QCliNode *QCliFrozenTree::node(int nodeIndex) const
+{
+	return _nodes[nodeIndex].node;
+}
+
+bool QCliFrozenTree::isLazy(int nodeIndex) const
+{
+	return _nodes[nodeIndex].lazy;
+}
+
+int QCliFrozenTree::findChild(int nodeIndex, QStringView name) const
+{
+	const auto index = slot(_nodes[nodeIndex].children, name);
+	if(index == -1 || QStringView{_childEntries[index].name} != name)
+		return -1;
+	else
+		return _childEntries[index].index;
+}
+
+int QCliFrozenTree::optionCount(int nodeIndex) const
+{
+	return _nodes[nodeIndex].optionCount;
+}
+
+const QCommandLineOption &QCliFrozenTree::option(int nodeIndex, int optionIndex) const
+{
+	return _options[_nodes[nodeIndex].optionOffset + optionIndex];
+}
+
+int QCliFrozenTree::findOption(int nodeIndex, QStringView name) const
+{
+	const auto index = slot(_nodes[nodeIndex].options, name);
+	if(index == -1 || QStringView{_optionEntries[index].name} != name)
+		return -1;
+	else
+		return _optionEntries[index].index;
+}
+
+int QCliFrozenTree::localOption(int nodeIndex, int localIndex) const
+{
+	return _localOptions[_nodes[nodeIndex].localOptionOffset + localIndex];
+}
+
+quint32 QCliFrozenTree::hash(QStringView key, quint32 seed)
+{
+	// FNV-1a with a murmur3 finalizer
+	auto h = 2166136261u ^ (seed * 16777619u);
+	for(const auto c : key) {
+		h ^= c.unicode();
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+int QCliFrozenTree::addNode(const QCliNode *node, const QVector<QCommandLineOption> &inheritedOptions)
+{
+	const auto nodeIndex = _nodes.size();
+	_nodes.append(Node{});
+
+	// collect the options, with the same rules as QCliParser::registerOptions
+	auto options = inheritedOptions;
+	QHash<QString, int> knownNames;
+	for(auto i = 0; i < inheritedOptions.size(); i++) {
+		for(const auto &name : inheritedOptions[i].names())
+			knownNames.insert(name, i);
+	}
+	_nodes[nodeIndex].localOptionOffset = _localOptions.size();
+	for(const auto &option : node->_options) {
+		const auto names = option.names();
+		auto knownIndex = -1;
+		for(const auto &name : names) {
+			knownIndex = knownNames.value(name, -1);
+			if(knownIndex != -1)
+				break;
+		}
+		// skipped options resolve to the one that shadows them
+		if(knownIndex != -1) {
+			_localOptions.append(knownIndex);
+			continue;
+		}
+		_localOptions.append(options.size());
+		for(const auto &name : names)
+			knownNames.insert(name, options.size());
+		options.append(option);
+	}
+
+	QVector<Entry> optionEntries;
+	optionEntries.reserve(knownNames.size());
+	for(auto i = 0; i < options.size(); i++) {
+		for(const auto &name : options[i].names())
+			optionEntries.append({name, i});
+	}
+
+	_nodes[nodeIndex].node = node;
+	_nodes[nodeIndex].optionOffset = _options.size();
+	_nodes[nodeIndex].optionCount = options.size();
+	_nodes[nodeIndex].options = createTable(optionEntries, _optionEntries);
+	_options.append(options);
+
+	// add all children. Lazy contexts stay unresolved and are parsed from the live tree
+	const auto context = dynamic_cast<const QCliContext*>(node);
+	if(context && context->isLazy())
+		_nodes[nodeIndex].lazy = true;
+	else if(context) {
+		QVector<Entry> childEntries;
+		childEntries.reserve(context->_nodes.size());
+		for(auto it = context->_nodes.constBegin(); it != context->_nodes.constEnd(); ++it)
+			childEntries.append({it.key(), addNode(it->second.data(), options)});
+		_nodes[nodeIndex].children = createTable(childEntries, _childEntries);
+	}
+
+	return nodeIndex;
+}
+
+QCliFrozenTree::HashTable QCliFrozenTree::createTable(const QVector<Entry> &entries, QVector<Entry> &target)
+{
+	// "hash and displace": keys are distributed into buckets by their unseeded hash. Starting with
+	// the largest bucket, a seed is searched that maps all keys of a bucket to free slots. Buckets
+	// with a single key are placed directly into the remaining slots (stored as negative values)
+	HashTable table;
+	table.slotCount = entries.size();
+	table.slotOffset = target.size();
+	table.bucketCount = entries.size();
+	table.bucketOffset = _displacements.size();
+	if(entries.isEmpty())
+		return table;
+
+	const auto slotCount = static_cast<quint32>(table.slotCount);
+	QVector<QVector<int>> buckets(table.bucketCount);
+	for(auto i = 0; i < entries.size(); i++)
+		buckets[static_cast<int>(hash(entries[i].name, 0) % slotCount)].append(i);
+	QVector<int> bucketOrder(table.bucketCount);
+	std::iota(bucketOrder.begin(), bucketOrder.end(), 0);
+	std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](int lhs, int rhs) {
+		return buckets[lhs].size() > buckets[rhs].size();
+	});
+
+	QVector<qint32> displacements(table.bucketCount, 0);
+	QVector<int> slotEntries(table.slotCount, -1);
+	auto freeSlot = 0;
+	for(const auto bucketIndex : bucketOrder) {
+		const auto &bucket = buckets[bucketIndex];
+		if(bucket.isEmpty())
+			break;
+		else if(bucket.size() == 1) {
+			while(slotEntries[freeSlot] != -1)
+				freeSlot++;
+			slotEntries[freeSlot] = bucket.first();
+			displacements[bucketIndex] = -freeSlot - 1;
+			continue;
+		}
+
+		QVector<int> bucketSlots(bucket.size());
+		for(qint32 seed = 1; ; seed++) {
+			Q_ASSERT_X(seed < 0x100000, Q_FUNC_INFO, "Unable to create perfect hash - duplicated keys?");
+			auto fits = true;
+			for(auto i = 0; fits && i < bucket.size(); i++) {
+				bucketSlots[i] = static_cast<int>(hash(entries[bucket[i]].name, static_cast<quint32>(seed)) % slotCount);
+				fits = slotEntries[bucketSlots[i]] == -1 &&
+					   !std::count(bucketSlots.constBegin(), bucketSlots.constBegin() + i, bucketSlots[i]);
+			}
+			if(fits) {
+				for(auto i = 0; i < bucket.size(); i++)
+					slotEntries[bucketSlots[i]] = bucket[i];
+				displacements[bucketIndex] = seed;
+				break;
+			}
+		}
+	}
+
+	_displacements.append(displacements);
+	target.reserve(target.size() + table.slotCount);
+	for(const auto entryIndex : slotEntries)
+		target.append(entries[entryIndex]);
+	return table;
+}
+
+int QCliFrozenTree::slot(const HashTable &table, QStringView key) const
+{
+	if(table.slotCount == 0)
+		return -1;
+
+	const auto slotCount = static_cast<quint32>(table.slotCount);
+	const auto displacement = _displacements[table.bucketOffset + static_cast<int>(hash(key, 0) % slotCount)];
+	if(displacement < 0)
+		return table.slotOffset - displacement - 1;
+	else
+		return table.slotOffset + static_cast<int>(hash(key, static_cast<quint32>(displacement)) % slotCount);
+}
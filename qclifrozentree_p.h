@@ -0,0 +1,67 @@
+#ifndef QCLIFROZENTREE_P_H
+#define QCLIFROZENTREE_P_H
+
+#include "qclinode.h"
+
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+
+// Immutable, flat copy of a QCliContext tree. All nodes, child names and option names are stored in
+// contiguous arrays, and each node has a minimal perfect hash for its children and for all options
+// available in it (including the ones inherited from the parent contexts). Options are stored as
+// (implicitly shared) copies, so parse results that reference the tree stay valid on their own
+class QCliFrozenTree
+{
+	Q_DISABLE_COPY(QCliFrozenTree)
+
+public:
+	QCliFrozenTree(const QCliContext *root, const QList<QCommandLineOption> &builtinOptions);
+
+	const QCliNode *node(int nodeIndex) const;
+	bool isLazy(int nodeIndex) const;
+	int findChild(int nodeIndex, QStringView name) const;
+
+	int optionCount(int nodeIndex) const;
+	const QCommandLineOption &option(int nodeIndex, int optionIndex) const;
+	int findOption(int nodeIndex, QStringView name) const;
+	// index of the option at position localIndex of the nodes own option list
+	int localOption(int nodeIndex, int localIndex) const;
+
+	static quint32 hash(QStringView key, quint32 seed);
+
+private:
+	struct HashTable {
+		int bucketOffset = 0;
+		int bucketCount = 0;
+		int slotOffset = 0;
+		int slotCount = 0;
+	};
+
+	struct Node {
+		const QCliNode *node = nullptr;
+		bool lazy = false;
+		int optionOffset = 0;
+		int optionCount = 0;
+		int localOptionOffset = 0;
+		HashTable children;
+		HashTable options;
+	};
+
+	struct Entry {
+		QString name;
+		int index;
+	};
+
+	QVector<Node> _nodes;
+	QVector<QCommandLineOption> _options;
+	QVector<int> _localOptions;
+	QVector<Entry> _childEntries;
+	QVector<Entry> _optionEntries;
+	QVector<qint32> _displacements;
+
+	int addNode(const QCliNode *node, const QVector<QCommandLineOption> &inheritedOptions);
+	HashTable createTable(const QVector<Entry> &entries, QVector<Entry> &target);
+	int slot(const HashTable &table, QStringView key) const;
+};
+
+#endif // QCLIFROZENTREE_P_H
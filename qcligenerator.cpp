@@ -1,42 +1,229 @@
 #include "qcligenerator.h"
+#include "qcligenerator_p.h"
+#include <QtCore/QMetaMethod>
+#include <QtCore/QMetaProperty>
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QDebug>
+
+namespace {
+
+#ifdef QT_NO_DEBUG
+constexpr auto LogScope = QtFatalMsg;
+#else
+constexpr auto LogScope = QtDebugMsg;
+#endif
+
+Q_LOGGING_CATEGORY(cliGen, "QCliGenerator", LogScope)
+
+struct InfoCache {
+	QMutex mutex;
+	QHash<const QMetaObject*, QSharedPointer<const QCliGeneratorInfo>> infos;
+};
+Q_GLOBAL_STATIC(InfoCache, infoCache)
+
+QString cliName(const QByteArray &memberName)
+{
+	return QString::fromUtf8(memberName).replace(QLatin1Char('_'), QLatin1Char('-'));
+}
+
+}
 
 QCliGenerator::QCliGenerator(QObject *parent) :
-	QObject(parent)
+	QObject(parent),
+	_orchestrator(nullptr),
+	_ownsOrchestrator(false),
+	_contextMutex(),
+	_contexts(),
+	_evaluator(new QCliGeneratorEvaluator{this}),
+	_evaluatorPaths()
 {}
 
+QCliGenerator::~QCliGenerator()
+{
+	if(_ownsOrchestrator)
+		delete _orchestrator;
+}
+
 bool QCliGenerator::setOrchestrator(QCliOrchestrator *orchestrator, bool takeOwnership)
 {
+	if(_orchestrator) {
+		if(takeOwnership)
+			delete orchestrator;
+		return false;
+	}
 
+	_orchestrator = orchestrator;
+	_ownsOrchestrator = takeOwnership;
+	return true;
 }
 
 bool QCliGenerator::addContext(const QMetaObject *generatorMetaObject)
 {
-
+	const auto info = QCliGeneratorInfo::get(generatorMetaObject);
+	if(!info || !info->annotated) {
+		qCWarning(cliGen) << "Class" << generatorMetaObject->className()
+						  << "is not a generator - it must be annotated with Q_CLI_CONTEXT_OBJECT";
+		return false;
+	}
+	return addContext(generatorMetaObject, info->path);
 }
 
 bool QCliGenerator::addContext(QObject *generator)
 {
-
+	return addContext(generator->metaObject());
 }
 
 void QCliGenerator::prepareParser(QCliParser &parser)
 {
-
+	fillContext(parser, {});
 }
 
 void QCliGenerator::prepareParser(QCommandLineParser &parser)
 {
-
+	// a plain parser has no contexts: the root options, and the first argument selects the method
+	const auto info = context({});
+	if(!info)
+		return;
+	for(const auto &option : info->options)
+		parser.addOption(option.option);
+	if(!info->leaves.isEmpty()) {
+		QStringList names;
+		names.reserve(info->leaves.size());
+		for(const auto &leaf : info->leaves)
+			names.append(leaf.name);
+		parser.addPositionalArgument(QStringLiteral("command"),
+									 tr("One of: %1").arg(names.join(QStringLiteral(", "))),
+									 QStringLiteral("<command> [arguments...]"));
+	}
 }
 
 int QCliGenerator::exec(QCliParser &parser)
 {
-
+	const auto chain = parser.contextChain();
+	if(chain.isEmpty()) {
+		qCCritical(cliGen) << "Unable to execute the root context - it must have been parsed into a leaf";
+		return EXIT_FAILURE;
+	}
+	if(!prepareEvaluator(chain.mid(0, chain.size() - 1), chain.last()))
+		return EXIT_FAILURE;
+	return _evaluator->exec(parser);
 }
 
 int QCliGenerator::exec(QCommandLineParser &parser)
 {
+	if(!prepareEvaluator({}, parser.positionalArguments().value(0)))
+		return EXIT_FAILURE;
+	return _evaluator->execCommand(parser);
+}
 
+bool QCliGenerator::addContext(const QMetaObject *generatorMetaObject, const QStringList &path)
+{
+	if(!generatorMetaObject->inherits(&QObject::staticMetaObject))
+		return false;
+	const auto info = QCliGeneratorInfo::get(generatorMetaObject);
+	QMutexLocker locker{&_contextMutex};
+	if(_contexts.contains(path))
+		return false;
+	_contexts.insert(path, info);
+	return true;
+}
+
+QSharedPointer<const QCliGeneratorInfo> QCliGenerator::context(const QStringList &path) const
+{
+	QMutexLocker locker{&_contextMutex};
+	return _contexts.value(path);
+}
+
+void QCliGenerator::fillContext(QCliContext &node, const QStringList &path)
+{
+	const auto info = context(path);
+	if(info) {
+		for(const auto &option : info->options) {
+			if(option.type.type() == QCliValueType::String)
+				node.addOption(option.option);
+			else
+				node.addOption(option.option, option.type, 0, -1);
+		}
+		for(const auto &leaf : info->leaves) {
+			const auto leafNode = node.addLeafNode(leaf.name, leaf.description);
+			if(!leafNode) {
+				qCWarning(cliGen) << "Skipping duplicate node" << leaf.name << "in context" << path;
+				continue;
+			}
+			for(const auto &positional : leaf.positionals)
+				leafNode->addPositionalArgument(std::get<0>(positional), std::get<1>(positional), std::get<2>(positional));
+		}
+		if(!info->defaultNode.isEmpty())
+			node.setDefaultNode(info->defaultNode);
+	}
+
+	// child contexts: all generators below this path, including the ones that only exist as part of a longer path
+	QList<QPair<QString, QSharedPointer<const QCliGeneratorInfo>>> children;
+	{
+		QMutexLocker locker{&_contextMutex};
+		for(auto it = _contexts.constBegin(); it != _contexts.constEnd(); ++it) {
+			if(it.key().size() <= path.size() || it.key().mid(0, path.size()) != path)
+				continue;
+			const auto name = it.key()[path.size()];
+			const auto isChild = it.key().size() == path.size() + 1;
+			auto known = false;
+			for(auto &child : children) {
+				if(child.first == name) {
+					if(isChild)
+						child.second = *it;
+					known = true;
+					break;
+				}
+			}
+			if(!known)
+				children.append(qMakePair(name, isChild ? *it : QSharedPointer<const QCliGeneratorInfo>{}));
+		}
+	}
+	for(const auto &child : children) {
+		const auto childNode = node.addContextNode(child.first, child.second ? child.second->description : QString{});
+		if(childNode)
+			fillContext(*childNode, path + QStringList{child.first});
+		else
+			qCWarning(cliGen) << "Skipping duplicate node" << child.first << "in context" << path;
+	}
+
+	// orchestrated contexts are only created once they are used
+	if(!_orchestrator)
+		return;
+	for(const auto &child : _orchestrator->contextList(path)) {
+		const auto childPath = path + QStringList{child.first};
+		if(context(childPath) || node.getNode(child.first))
+			continue;
+		node.addLazyContextNode(child.first, child.second, [this, childPath](QCliContext &lazyNode) {
+			loadContext(lazyNode, childPath);
+		});
+	}
+}
+
+void QCliGenerator::loadContext(QCliContext &node, const QStringList &path)
+{
+	const auto generator = _orchestrator->createGenerator(path, this);
+	if(generator) {
+		addContext(generator->metaObject(), path);
+		delete generator;
+	}
+	fillContext(node, path);
+}
+
+bool QCliGenerator::prepareEvaluator(const QStringList &path, const QString &leafName)
+{
+	const auto info = context(path);
+	if(!info || !info->leaf(leafName)) {
+		qCCritical(cliGen) << "Unable to find any generator method for" << (path + QStringList{leafName});
+		return false;
+	}
+
+	// registering clears the plans of the evaluator, so every context is only registered once
+	if(!_evaluatorPaths.contains(path)) {
+		_evaluator->registerEvaluator(info->metaObject, path);
+		_evaluatorPaths.insert(path);
+	}
+	return true;
 }
 
 
@@ -48,15 +235,243 @@ QCliOrchestrator::~QCliOrchestrator() = default;
 
 
 QCliMetaOrchestrator::QCliMetaOrchestrator(QObject *parent) :
-	QObject{parent}
+	QObject{parent},
+	_mutex(),
+	_resolved(false),
+	_generators()
 {}
 
 QList<QPair<QString, QString>> QCliMetaOrchestrator::contextList(const QStringList &prefix) const
 {
-
+	// direct children, including the ones that only exist as part of a longer path
+	QList<QPair<QString, QString>> contexts;
+	for(const auto &info : generators()) {
+		if(info->path.size() <= prefix.size() || info->path.mid(0, prefix.size()) != prefix)
+			continue;
+		const auto name = info->path[prefix.size()];
+		const auto description = info->path.size() == prefix.size() + 1 ? info->description : QString{};
+		auto known = false;
+		for(auto &context : contexts) {
+			if(context.first == name) {
+				if(!description.isEmpty())
+					context.second = description;
+				known = true;
+				break;
+			}
+		}
+		if(!known)
+			contexts.append(qMakePair(name, description));
+	}
+	return contexts;
 }
 
 const QObject *QCliMetaOrchestrator::createGenerator(const QStringList &context, QObject *parent)
 {
+	for(const auto &info : generators()) {
+		if(info->path == context)
+			return info->metaObject->newInstance(Q_ARG(QObject*, parent));
+	}
+	return nullptr;
+}
+
+const QVector<QSharedPointer<const QCliGeneratorInfo>> &QCliMetaOrchestrator::generators() const
+{
+	QMutexLocker locker{&_mutex};
+	if(_resolved)
+		return _generators;
+	_resolved = true;
+
+	const auto mo = metaObject();
+	if(mo->indexOfClassInfo("__q_cli_orchestrator") == -1) {
+		qCWarning(cliGen) << "Class" << mo->className() << "is not annotated with Q_CLI_ORCHESTRATOR_OBJECT";
+		return _generators;
+	}
+	for(auto i = 0; i < mo->classInfoCount(); i++) {
+		const auto classInfo = mo->classInfo(i);
+		if(qstrcmp(classInfo.name(), "__q_cli_generator") != 0)
+			continue;
+		const auto typeId = QMetaType::type(classInfo.value());
+		const auto generatorMo = QMetaType::typeFlags(typeId).testFlag(QMetaType::PointerToQObject) ?
+									 QMetaType::metaObjectForType(typeId) :
+									 nullptr;
+		const auto info = generatorMo ? QCliGeneratorInfo::get(generatorMo) : QSharedPointer<const QCliGeneratorInfo>{};
+		if(info && info->annotated)
+			_generators.append(info);
+		else
+			qCWarning(cliGen) << "Unable to resolve generator" << classInfo.value() << "- make shure it is registered as pointer type";
+	}
+	return _generators;
+}
+
+
+
+QCliGeneratorEvaluator::QCliGeneratorEvaluator(QObject *parent) :
+	QCliEvaluator{parent}
+{
+	// only the registered generators are executed
+	setAutoResolveObjects(false);
+}
+
+QByteArray QCliGeneratorEvaluator::evaluatorMethodName(const QMetaObject *metaObject, const QStringList &contextList) const
+{
+	// the generators are registered for their context, so only the leaf is left
+	const auto info = QCliGeneratorInfo::get(metaObject);
+	const auto leaf = contextList.size() == 1 ? info->leaf(contextList.first()) : nullptr;
+	return leaf ? metaObject->method(leaf->methodIndex).name() : QByteArray{};
+}
+
+
+
+QSharedPointer<const QCliGeneratorInfo> QCliGeneratorInfo::get(const QMetaObject *metaObject)
+{
+	const auto cache = infoCache();
+	QMutexLocker locker{&cache->mutex};
+	auto it = cache->infos.constFind(metaObject);
+	if(it == cache->infos.constEnd())
+		it = cache->infos.insert(metaObject, scan(metaObject));
+	return *it;
+}
+
+QString QCliGeneratorInfo::classInfo(const QMetaObject *metaObject, const char *key)
+{
+	const auto index = metaObject->indexOfClassInfo(key);
+	if(index == -1)
+		return {};
+	return QString::fromUtf8(metaObject->classInfo(index).value());
+}
+
+QCliValueType QCliGeneratorInfo::valueType(const QMetaProperty &property)
+{
+	// flags and bools stay plain: flags are written as "a|b" strings, and bools are switches without a value
+	if(property.isEnumType() && !property.isFlagType()) {
+		const auto enumerator = property.enumerator();
+		QStringList keys;
+		keys.reserve(enumerator.keyCount());
+		for(auto i = 0; i < enumerator.keyCount(); i++)
+			keys.append(QString::fromUtf8(enumerator.key(i)));
+		return QCliValueType{keys};
+	}
+
+	switch(property.userType()) {
+	case QMetaType::Short:
+	case QMetaType::UShort:
+	case QMetaType::Int:
+	case QMetaType::UInt:
+	case QMetaType::Long:
+	case QMetaType::ULong:
+	case QMetaType::LongLong:
+	case QMetaType::ULongLong:
+		return QCliValueType::Int;
+	case QMetaType::Float:
+	case QMetaType::Double:
+		return QCliValueType::Double;
+	default:
+		return QCliValueType::String;
+	}
+}
+
+const QCliGeneratorInfo::Leaf *QCliGeneratorInfo::leaf(const QString &name) const
+{
+	for(const auto &leaf : leaves) {
+		if(leaf.name == name)
+			return &leaf;
+	}
+	return nullptr;
+}
+
+QSharedPointer<const QCliGeneratorInfo> QCliGeneratorInfo::scan(const QMetaObject *metaObject)
+{
+	QSharedPointer<QCliGeneratorInfo> info{new QCliGeneratorInfo{}};
+	info->metaObject = metaObject;
+	info->annotated = metaObject->indexOfClassInfo("__q_cli_context") != -1;
+	for(const auto &segment : classInfo(metaObject, "__q_cli_context").split(QLatin1Char('.'))) {
+		if(!segment.isEmpty())
+			info->path.append(segment);
+	}
+	info->description = classInfo(metaObject, "__q_cli_description");
+	info->defaultNode = classInfo(metaObject, "__q_cli_default");
+	auto prefix = classInfo(metaObject, "__q_cli_prefix").toUtf8();
+	if(prefix.isEmpty())
+		prefix = QByteArrayLiteral("qCli_");
+	const auto describe = [metaObject](const QByteArray &member) {
+		return classInfo(metaObject, QByteArray{QByteArrayLiteral("__q_cli_description_") + member}.constData());
+	};
+
+	// writable properties declared below QObject are the options
+	for(auto pIdx = QObject::staticMetaObject.propertyCount(); pIdx < metaObject->propertyCount(); ++pIdx) {
+		const auto property = metaObject->property(pIdx);
+		if(!property.isWritable())
+			continue;
+		const auto name = cliName(property.name());
+		info->options.append(Option {
+			property.userType() == QMetaType::Bool ?
+				QCommandLineOption{name, describe(property.name())} :
+				QCommandLineOption{name, describe(property.name()), name},
+			valueType(property)
+		});
+	}
+
+	// public methods with the prefix that return an int or a QFuture<int> are the leaves
+	QVector<QMetaMethod> methods;
+	QHash<QByteArray, int> methodCounts;
+	for(auto mIdx = QObject::staticMetaObject.methodCount(); mIdx < metaObject->methodCount(); ++mIdx) {
+		const auto method = metaObject->method(mIdx);
+		if((method.methodType() != QMetaMethod::Method &&
+			method.methodType() != QMetaMethod::Slot) ||
+		   method.access() != QMetaMethod::Public ||
+		   (method.returnType() != QMetaType::Int && qstrcmp(method.typeName(), "QFuture<int>") != 0) ||
+		   !method.name().startsWith(prefix) ||
+		   method.name().size() == prefix.size())
+			continue;
+		// moc adds a clone per default argument. They belong to the original method
+		if(method.attributes().testFlag(QMetaMethod::Cloned))
+			continue;
+		methods.append(method);
+		++methodCounts[method.name()];
+	}
+
+	const auto rangeType = qMetaTypeId<QCliPositionalRange>();
+	for(const auto &method : qAsConst(methods)) {
+		// the evaluator dispatches by name, so help could only ever describe one of the overloads
+		if(methodCounts.value(method.name()) > 1) {
+			qCWarning(cliGen) << "Skipping method" << method.methodSignature() << "- overloaded methods cannot be leaves";
+			continue;
+		}
+
+		Leaf leaf;
+		leaf.name = cliName(method.name().mid(prefix.size()));
+		leaf.description = describe(method.name());
+		leaf.methodIndex = method.methodIndex();
+		for(auto pIdx = 0; pIdx < method.parameterCount(); ++pIdx)
+			leaf.parameterTypes.append(method.parameterType(pIdx));
+		leaf.argCount = leaf.parameterTypes.size();
+		if(leaf.argCount > 0) {
+			const auto lastType = leaf.parameterTypes.last();
+			if(lastType == QMetaType::QStringList ||
+			   lastType == QMetaType::QByteArrayList ||
+			   lastType == QMetaType::QVariantList ||
+			   lastType == rangeType)
+				--leaf.argCount;
+		}
+		if(leaf.parameterTypes.size() > 10) {
+			qCWarning(cliGen) << "Skipping method" << method.methodSignature() << "- it has more than 10 parameters";
+			continue;
+		}
+
+		const auto parameterNames = method.parameterNames();
+		for(auto pIdx = 0; pIdx < parameterNames.size(); ++pIdx) {
+			const auto name = parameterNames[pIdx].isEmpty() ?
+								  QStringLiteral("arg%1").arg(pIdx + 1) :
+								  QString::fromUtf8(parameterNames[pIdx]);
+			const auto isList = pIdx == leaf.argCount;
+			leaf.positionals.append(std::make_tuple(name,
+													describe(method.name() + '.' + parameterNames[pIdx]),
+													isList ?
+														QStringLiteral("[%1...]").arg(name) :
+														QStringLiteral("<%1>").arg(name)));
+		}
+		info->leaves.append(leaf);
+	}
 
+	return info;
 }
@@ -2,10 +2,15 @@
 #define QCLIGENERATOR_H
 
 #include <QObject>
+#include <QMutex>
+#include <QSet>
 #include "qcliparser.h"
 
 #include "qcligenerator_meta.h"
 
+class QCliGeneratorInfo;
+class QCliGeneratorEvaluator;
+
 class Q_CLI_PARSER_EXPORT QCliOrchestrator
 {
 	Q_DISABLE_COPY(QCliOrchestrator)
@@ -13,13 +18,17 @@ public:
 	QCliOrchestrator();
 	virtual ~QCliOrchestrator();
 
+	// (name, description) of the direct child contexts of prefix
 	virtual QList<QPair<QString, QString>> contextList(const QStringList &prefix) const = 0;
+	// only the meta object of the returned generator is used. It is deleted once it was inspected
 	virtual const QObject *createGenerator(const QStringList &context, QObject *parent) = 0;
 };
 
 #define QCliOrchestratorIid "de.skycoder42.qcliparser.QCliOrchestrator"
 Q_DECLARE_INTERFACE(QCliOrchestrator, QCliOrchestratorIid)
 
+// Orchestrator for the generators listed with Q_CLI_GENERATOR in a subclass that is annotated with
+// Q_CLI_ORCHESTRATOR_OBJECT(). The generator classes are resolved once, when first needed
 class Q_CLI_PARSER_EXPORT QCliMetaOrchestrator : public QObject, public QCliOrchestrator
 {
 	Q_OBJECT
@@ -32,15 +41,23 @@ public:
 	const QObject *createGenerator(const QStringList &context, QObject *parent) override;
 
 private:
+	mutable QMutex _mutex;
+	mutable bool _resolved;
+	mutable QVector<QSharedPointer<const QCliGeneratorInfo>> _generators;
 
+	const QVector<QSharedPointer<const QCliGeneratorInfo>> &generators() const;
 };
 
+// Builds the context tree of a parser from annotated generator classes (see qcligenerator_meta.h)
+// and executes their methods. Generators added with addContext are part of the tree right away,
+// the ones of an orchestrator are added as lazy contexts and only created when a context is used
 class Q_CLI_PARSER_EXPORT QCliGenerator : public QObject
 {
 	Q_OBJECT
 
 public:
 	explicit QCliGenerator(QObject *parent = nullptr);
+	~QCliGenerator() override;
 
 	template <typename TOchestrator>
 	bool setOrchestrator();
@@ -56,6 +73,36 @@ public:
 
 	Q_INVOKABLE int exec(QCliParser &parser);
 	Q_INVOKABLE int exec(QCommandLineParser &parser);
+
+private:
+	QCliOrchestrator *_orchestrator;
+	bool _ownsOrchestrator;
+	// lazy contexts may add generators while other threads parse
+	mutable QMutex _contextMutex;
+	QHash<QStringList, QSharedPointer<const QCliGeneratorInfo>> _contexts;
+	// runs the leaves, with the same conversion and dispatch as any other evaluator
+	QCliGeneratorEvaluator *_evaluator;
+	QSet<QStringList> _evaluatorPaths;
+
+	bool addContext(const QMetaObject *generatorMetaObject, const QStringList &path);
+	QSharedPointer<const QCliGeneratorInfo> context(const QStringList &path) const;
+	void fillContext(QCliContext &node, const QStringList &path);
+	void loadContext(QCliContext &node, const QStringList &path);
+	bool prepareEvaluator(const QStringList &path, const QString &leafName);
 };
 
+template <typename TOchestrator>
+bool QCliGenerator::setOrchestrator()
+{
+	static_assert(std::is_base_of_v<QCliOrchestrator, TOchestrator>, "TOchestrator must implement QCliOrchestrator!");
+	return setOrchestrator(new TOchestrator{}, true);
+}
+
+template <typename TGenerator>
+bool QCliGenerator::addContext(const QStringList &path)
+{
+	static_assert(std::is_base_of_v<QObject, TGenerator>, "TGenerator must extend QObject!");
+	return addContext(&TGenerator::staticMetaObject, path);
+}
+
 #endif // QCLIGENERATOR_H
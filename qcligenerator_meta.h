@@ -3,8 +3,17 @@
 
 #include <QObject>
 
+// Annotations for QCliGenerator classes. A generator describes one context: its writable properties
+// become options and its public int (or QFuture<int>) methods named "<prefix><name>" become leaves. Paths are dot
+// separated, e.g. Q_CLI_CONTEXT_OBJECT(build.test), and Q_CLI_CONTEXT_OBJECT() is the root
 #define Q_CLI_ORCHESTRATOR_OBJECT() Q_CLASSINFO("__q_cli_orchestrator", "")
 #define Q_CLI_CONTEXT_OBJECT(path) Q_CLASSINFO("__q_cli_context", #path)
-#define Q_CLI_PREFIX(prefix), Q_CLASSINFO("__q_cli_prefix", #prefix "_")  // defaults to "qCli_"
+#define Q_CLI_PREFIX(prefix) Q_CLASSINFO("__q_cli_prefix", #prefix "_")  // defaults to "qCli_"
+#define Q_CLI_CONTEXT_DESCRIPTION(description) Q_CLASSINFO("__q_cli_description", description)
+// member is a property, a method or "<method>.<parameter>" for positional arguments
+#define Q_CLI_DESCRIPTION(member, description) Q_CLASSINFO("__q_cli_description_" #member, description)
+#define Q_CLI_DEFAULT_NODE(name) Q_CLASSINFO("__q_cli_default", #name)
+// generators of a QCliMetaOrchestrator. The class must be registered as pointer type (qRegisterMetaType<TClass*>())
+#define Q_CLI_GENERATOR(className) Q_CLASSINFO("__q_cli_generator", #className "*")
 
 #endif // QCLIGENERATOR_META_H
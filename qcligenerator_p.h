@@ -0,0 +1,64 @@
+#ifndef QCLIGENERATOR_P_H
+#define QCLIGENERATOR_P_H
+
+#include <tuple>
+
+#include "qclievaluator.h"
+
+#include <QtCore/QCommandLineOption>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMetaProperty>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+// Everything QCliGenerator needs to know about an annotated class. The scan over the properties,
+// methods and class infos runs once per class and process, and the result is shared
+class QCliGeneratorInfo
+{
+public:
+	struct Option {
+		QCommandLineOption option;
+		QCliValueType type; // String for plain options, which are added untyped
+	};
+
+	struct Leaf {
+		QString name;
+		QString description;
+		int methodIndex;
+		int argCount; // without the list of additional arguments
+		QVector<int> parameterTypes;
+		QList<std::tuple<QString, QString, QString>> positionals;
+	};
+
+	const QMetaObject *metaObject = nullptr;
+	bool annotated = false; // has a Q_CLI_CONTEXT_OBJECT
+	QStringList path;
+	QString description;
+	QString defaultNode;
+	QVector<Option> options;
+	QVector<Leaf> leaves;
+
+	static QSharedPointer<const QCliGeneratorInfo> get(const QMetaObject *metaObject);
+	static QString classInfo(const QMetaObject *metaObject, const char *key);
+	// the type that validates a property's values while parsing
+	static QCliValueType valueType(const QMetaProperty &property);
+
+	const Leaf *leaf(const QString &name) const;
+
+private:
+	static QSharedPointer<const QCliGeneratorInfo> scan(const QMetaObject *metaObject);
+};
+
+// Executes the leaves of generators. The generators are registered per context path, and the
+// leaf name selects the method that was found for it by the scan
+class QCliGeneratorEvaluator : public QCliEvaluator
+{
+public:
+	explicit QCliGeneratorEvaluator(QObject *parent = nullptr);
+
+protected:
+	QByteArray evaluatorMethodName(const QMetaObject *metaObject, const QStringList &contextList) const override;
+};
+
+#endif // QCLIGENERATOR_P_H
@@ -1,38 +1,80 @@
 #include "qclinode.h"
+#include "qclinodearena_p.h"
+
+namespace {
+
+// below that, a linear search over the option names is faster than building a hash set
+constexpr int KeyCacheThreshold = 16;
+
+}
+
+QCliOptionHandle::QCliOptionHandle() :
+	_node(nullptr),
+	_index(-1)
+{}
+
+QCliOptionHandle::QCliOptionHandle(const QCliNode *node, int index) :
+	_node(node),
+	_index(index)
+{}
+
+bool QCliOptionHandle::isValid() const
+{
+	return _node;
+}
+
+QCliOptionHandle::operator bool() const
+{
+	return isValid();
+}
+
+
 
 QCliNode::QCliNode() :
 	_options(),
+	_optionSpecs(),
 	_keyCache(),
-	_hidden(false)
+	_hidden(false),
+	_arena(nullptr)
 {}
 
 QCliNode::~QCliNode() = default;
 
-bool QCliNode::addOption(const QCommandLineOption &commandLineOption)
+QCliOptionHandle QCliNode::addOption(const QCommandLineOption &commandLineOption)
 {
 	for(const auto &key : commandLineOption.names()) {
-		if(_keyCache.contains(key))
-			return false;
+		if(containsOptionName(key))
+			return {};
 	}
 
 	_options.append(commandLineOption);
-	_keyCache.unite(QSet<QString>::fromList(commandLineOption.names()));
-	return true;
+	updateKeyCache(_options.size() - 1);
+	return QCliOptionHandle{this, _options.size() - 1};
+}
+
+QCliOptionHandle QCliNode::addOption(const QCommandLineOption &commandLineOption, const QCliValueType &type, int minCount, int maxCount)
+{
+	Q_ASSERT_X(minCount >= 0 && (maxCount == -1 || maxCount >= minCount), Q_FUNC_INFO, "Invalid option count");
+	const auto handle = addOption(commandLineOption);
+	if(handle)
+		_optionSpecs.insert(handle._index, QCliValueSpec{type, minCount, maxCount});
+	return handle;
 }
 
 bool QCliNode::addOptions(const QList<QCommandLineOption> &options)
 {
-	auto tSet(_keyCache);
+	QSet<QString> newKeys;
 	for(const auto &option : options) {
 		for(const auto &key : option.names()) {
-			if(tSet.contains(key))
+			if(containsOptionName(key) || newKeys.contains(key))
 				return false;
+			newKeys.insert(key);
 		}
-		tSet.unite(QSet<QString>::fromList(option.names()));
 	}
 
+	const auto firstNewOption = _options.size();
 	_options.append(options);
-	_keyCache.unite(tSet);
+	updateKeyCache(firstNewOption);
 	return true;
 }
 
@@ -46,27 +88,69 @@ bool QCliNode::isHidden() const
 	return _hidden;
 }
 
+bool QCliNode::containsOptionName(const QString &name) const
+{
+	if(!_keyCache.isEmpty())
+		return _keyCache.contains(name);
+	for(const auto &option : _options) {
+		if(option.names().contains(name))
+			return true;
+	}
+	return false;
+}
+
+void QCliNode::updateKeyCache(int firstNewOption)
+{
+	if(_options.size() <= KeyCacheThreshold)
+		return;
+	if(_keyCache.isEmpty()) // crossed the threshold -> index all options
+		firstNewOption = 0;
+	for(auto i = firstNewOption; i < _options.size(); i++) {
+		for(const auto &name : _options[i].names())
+			_keyCache.insert(name);
+	}
+}
+
+QString QCliNode::intern(const QString &string) const
+{
+	return _arena ? _arena->intern(string) : string;
+}
+
 
 QCliLeaf::QCliLeaf() :
 	QCliNode(),
-	_arguments()
+	_arguments(),
+	_argumentSpecs(),
+	_typedArguments(false)
 {}
 
 void QCliLeaf::addPositionalArgument(const QString &name, const QString &description, const QString &syntax)
 {
 	_arguments.append(std::make_tuple(
-						  name,
-						  description,
-						  syntax.isEmpty() ?
-							QStringLiteral("<%1>").arg(name) :
-							syntax
+						  intern(name),
+						  intern(description),
+						  intern(syntax.isEmpty() ?
+									 QStringLiteral("<%1>").arg(name) :
+									 syntax)
 					  ));
+	_argumentSpecs.append(QCliValueSpec{QCliValueType::String, 1, 1});
+}
+
+void QCliLeaf::addPositionalArgument(const QString &name, const QString &description, const QCliValueType &type, int minCount, int maxCount, const QString &syntax)
+{
+	Q_ASSERT_X(minCount >= 0 && (maxCount == -1 || maxCount >= minCount), Q_FUNC_INFO, "Invalid argument count");
+	addPositionalArgument(name, description, syntax);
+	_argumentSpecs.last() = QCliValueSpec{type, minCount, maxCount};
+	_typedArguments = true;
 }
 
 QCliContext::QCliContext() :
 	QCliNode(),
 	_nodes(),
-	_defaultNode()
+	_defaultNode(),
+	_factory(),
+	_factoryFlag(),
+	_lazy(false)
 {}
 
 bool QCliContext::addCliNode(const QString &name, const QString &description, const QSharedPointer<QCliNode> &node)
@@ -74,14 +158,15 @@ bool QCliContext::addCliNode(const QString &name, const QString &description, co
 	if(_nodes.contains(name))
 		return false;
 	else {
-		_nodes.insert(name, {description, node});
+		node->_arena = _arena;
+		_nodes.insert(intern(name), {intern(description), node});
 		return true;
 	}
 }
 
 QSharedPointer<QCliContext> QCliContext::addContextNode(const QString &name, const QString &description)
 {
-	auto ptr = QSharedPointer<QCliContext>::create();
+	auto ptr = createNode<QCliContext>();
 	if(addCliNode(name, description, ptr))
 		return ptr;
 	else
@@ -90,14 +175,50 @@ QSharedPointer<QCliContext> QCliContext::addContextNode(const QString &name, con
 
 QSharedPointer<QCliLeaf> QCliContext::addLeafNode(const QString &name, const QString &description)
 {
-	auto ptr = QSharedPointer<QCliLeaf>::create();
+	auto ptr = createNode<QCliLeaf>();
 	if(addCliNode(name, description, ptr))
 		return ptr;
 	else
 		return {};
 }
 
+QSharedPointer<QCliContext> QCliContext::addLazyContextNode(const QString &name, const QString &description, const std::function<void(QCliContext &)> &factory)
+{
+	auto ptr = addContextNode(name, description);
+	if(ptr) {
+		ptr->_factory = factory;
+		ptr->_lazy = true;
+	}
+	return ptr;
+}
+
+template <typename TNode>
+QSharedPointer<TNode> QCliContext::createNode() const
+{
+	if(_arena)
+		return _arena->create<TNode>();
+	else
+		return QSharedPointer<TNode>::create();
+}
+
 void QCliContext::setDefaultNode(const QString &name)
 {
 	_defaultNode = name;
 }
+
+bool QCliContext::isLazy() const
+{
+	return _lazy;
+}
+
+void QCliContext::createLazyNodes() const
+{
+	if(!_lazy)
+		return;
+
+	// the factory may be triggered by multiple parsers at once, but must only run once
+	std::call_once(_factoryFlag, [this]() {
+		_factory(*const_cast<QCliContext*>(this));
+		_lazy = false;
+	});
+}
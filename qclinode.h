@@ -2,22 +2,59 @@
 #define QCLINODE_H
 
 #include <tuple>
+#include <functional>
+#include <atomic>
+#include <mutex>
+
+#include "qclivaluetype.h"
 
 #include <QtCore/QCommandLineOption>
 #include <QtCore/QMap>
 #include <QtCore/QSet>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
 #include <QtCore/QSharedPointer>
 
+class QCliNodeArena;
+class QCliNode;
+
+// Identifies an option by the node it was added to and its position there. Parse results resolve
+// handles without any string lookup. Converts to bool like addOption did before it returned handles
+class Q_CLI_PARSER_EXPORT QCliOptionHandle
+{
+public:
+	QCliOptionHandle();
+
+	bool isValid() const;
+	operator bool() const;
+
+private:
+	friend class QCliNode;
+	friend class QCliParseResult;
+
+	const QCliNode *_node;
+	int _index;
+
+	QCliOptionHandle(const QCliNode *node, int index);
+};
+
 class Q_CLI_PARSER_EXPORT QCliNode
 {
 	friend class QCliParser;
+	friend class QCliFrozenTree;
+	friend class QCliCompleter;
+	friend class QCliLeaf;
+	friend class QCliContext;
+	friend class QCliSchemaImage;
 	Q_DISABLE_COPY(QCliNode)
 
 public:
 	QCliNode();
 	virtual ~QCliNode();
 
-	bool addOption(const QCommandLineOption &commandLineOption);
+	QCliOptionHandle addOption(const QCommandLineOption &commandLineOption);
+	// values are validated and converted while parsing, and the option must be given minCount to maxCount times
+	QCliOptionHandle addOption(const QCommandLineOption &commandLineOption, const QCliValueType &type, int minCount = 0, int maxCount = -1);
 	bool addOptions(const QList<QCommandLineOption> &options);
 
 	void setHidden(bool hidden);
@@ -25,25 +62,42 @@ public:
 
 private:
 	QList<QCommandLineOption> _options;
-	QSet<QString> _keyCache;
+	QHash<int, QCliValueSpec> _optionSpecs; // only for typed options, by local index
+	QSet<QString> _keyCache; // only built for nodes with many options
 	bool _hidden;
+	// set for all nodes of a parser with a node arena, see QCliParser::setNodeArenaEnabled
+	QCliNodeArena *_arena;
+
+	bool containsOptionName(const QString &name) const;
+	void updateKeyCache(int firstNewOption);
+	QString intern(const QString &string) const;
 };
 
 class Q_CLI_PARSER_EXPORT QCliLeaf : public QCliNode
 {
 	friend class QCliParser;
+	friend class QCliCompleter;
+	friend class QCliSchemaImage;
 public:
 	QCliLeaf();
 
 	void addPositionalArgument(const QString &name, const QString &description, const QString &syntax = {});
+	// the argument takes minCount to maxCount values. Once a leaf has typed arguments, the parser checks
+	// the argument count, with untyped arguments taking exactly one value
+	void addPositionalArgument(const QString &name, const QString &description, const QCliValueType &type, int minCount = 1, int maxCount = 1, const QString &syntax = {});
 
 private:
 	QList<std::tuple<QString, QString, QString>> _arguments;
+	QVector<QCliValueSpec> _argumentSpecs;
+	bool _typedArguments;
 };
 
 class Q_CLI_PARSER_EXPORT QCliContext : public QCliNode
 {
 	friend class QCliParser;
+	friend class QCliFrozenTree;
+	friend class QCliCompleter;
+	friend class QCliSchemaImage;
 
 public:
 	QCliContext();
@@ -51,14 +105,25 @@ public:
 	bool addCliNode(const QString &name, const QString &description, const QSharedPointer<QCliNode> &node);
 	QSharedPointer<QCliContext> addContextNode(const QString &name, const QString &description);
 	QSharedPointer<QCliLeaf> addLeafNode(const QString &name, const QString &description);
+	QSharedPointer<QCliContext> addLazyContextNode(const QString &name, const QString &description, const std::function<void(QCliContext&)> &factory);
 	void setDefaultNode(const QString &name);
 
+	bool isLazy() const;
+	void createLazyNodes() const;
+
 	template <typename TNode = QCliNode>
 	QSharedPointer<TNode> getNode(const QString &name) const;
 
 private:
+	template <typename TNode>
+	QSharedPointer<TNode> createNode() const;
+
 	QMap<QString, QPair<QString, QSharedPointer<QCliNode>>> _nodes;
 	QString _defaultNode;
+
+	std::function<void(QCliContext&)> _factory;
+	mutable std::once_flag _factoryFlag;
+	mutable std::atomic_bool _lazy;
 };
 
 // ------------- GENERIC IMPLEMENTATION -------------
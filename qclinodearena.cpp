@@ -0,0 +1,38 @@
+#include "qclinodearena_p.h"
+
+QCliNodeArena::QCliNodeArena() :
+	_mutex(),
+	_blocks(),
+	_blockUsed(BlockSize),
+	_objects(),
+	_strings()
+{}
+
+QCliNodeArena::~QCliNodeArena()
+{
+	// children are created after their parents -> reverse order destroys them first
+	for(auto it = _objects.crbegin(); it != _objects.crend(); ++it)
+		it->destroy(it->object);
+}
+
+QString QCliNodeArena::intern(const QString &string)
+{
+	if(string.isEmpty())
+		return string;
+	QMutexLocker locker{&_mutex};
+	auto it = _strings.constFind(string);
+	if(it == _strings.constEnd())
+		it = _strings.insert(string);
+	return *it;
+}
+
+void *QCliNodeArena::allocate(size_t size, size_t alignment)
+{
+	auto offset = (_blockUsed + alignment - 1) & ~(alignment - 1);
+	if(offset + size > BlockSize) {
+		_blocks.emplace_back(new char[BlockSize]);
+		offset = 0;
+	}
+	_blockUsed = offset + size;
+	return _blocks.back().get() + offset;
+}
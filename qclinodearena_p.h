@@ -0,0 +1,59 @@
+#ifndef QCLINODEARENA_P_H
+#define QCLINODEARENA_P_H
+
+#include <QtCore/QSharedPointer>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <new>
+#include <vector>
+#include <memory>
+
+// Monotonic storage for the nodes of a parser tree. Nodes are placed back to back in large blocks
+// and strings are interned, so that equal names and descriptions share their data. Nothing is freed
+// before the arena is destroyed, which then destroys all nodes in reverse order and releases the
+// blocks at once. Safe to use from multiple threads (lazy contexts may be created concurrently)
+class QCliNodeArena
+{
+	Q_DISABLE_COPY(QCliNodeArena)
+
+public:
+	QCliNodeArena();
+	~QCliNodeArena();
+
+	// the returned pointer does not own the node - it is destroyed with the arena
+	template <typename T>
+	QSharedPointer<T> create();
+
+	QString intern(const QString &string);
+
+private:
+	static constexpr size_t BlockSize = 64 * 1024;
+
+	struct Object {
+		void *object;
+		void (*destroy)(void *object);
+	};
+
+	QMutex _mutex;
+	std::vector<std::unique_ptr<char[]>> _blocks;
+	size_t _blockUsed;
+	QVector<Object> _objects;
+	QSet<QString> _strings;
+
+	void *allocate(size_t size, size_t alignment);
+};
+
+template <typename T>
+QSharedPointer<T> QCliNodeArena::create()
+{
+	static_assert(sizeof(T) <= BlockSize, "Node type too large for the arena");
+	QMutexLocker locker{&_mutex};
+	const auto object = new (allocate(sizeof(T), alignof(T))) T{};
+	_objects.append(Object{object, [](void *ptr) {
+		static_cast<T*>(ptr)->~T();
+	}});
+	return QSharedPointer<T>{object, [](T *) {}};
+}
+
+#endif // QCLINODEARENA_P_H
@@ -1,5 +1,19 @@
 #include "qcliparser.h"
+#include "qclifrozentree_p.h"
+#include "qclicompleter_p.h"
+#include "qclicompletionindex.h"
+#include "qcliargumentlist_p.h"
+#include "qclibktree_p.h"
+#include "qclinodearena_p.h"
+#include "qclidescriptioncatalog_p.h"
+#include "qclischemaimage_p.h"
 #include <QDebug>
+#include <QBitArray>
+#include <QFileInfo>
+#include <QFile>
+#include <QSaveFile>
+#include <QLoggingCategory>
+#include <algorithm>
 #if defined(Q_OS_WIN) && !defined(QT_BOOTSTRAPPED) && !defined(Q_OS_WINRT)
 #  include <qt_windows.h>
 #endif
@@ -10,6 +24,14 @@ extern void Q_CORE_EXPORT qt_call_post_routines();
 
 namespace {
 
+#ifdef QT_NO_DEBUG
+constexpr auto LogScope = QtFatalMsg;
+#else
+constexpr auto LogScope = QtDebugMsg;
+#endif
+
+Q_LOGGING_CATEGORY(cliParser, "QCliParser", LogScope)
+
 #if defined(Q_OS_WIN) && !defined(QT_BOOTSTRAPPED) && !defined(Q_OS_WINRT)
 // Return whether to use a message box. Use handles if a console can be obtained
 // or we are run with redirected handles (for example, by QProcess).
@@ -24,14 +46,23 @@ inline bool displayMessageBox()
 }
 #endif // Q_OS_WIN && !QT_BOOTSTRAPPED && !Q_OS_WIN && !Q_OS_WINRT
 
-void showParserMessage(const QString &message)
+enum MessageType {
+	UsageMessage,
+	ErrorMessage
+};
+
+void showParserMessage(const QString &message, MessageType type = ErrorMessage)
 {
 #if defined(Q_OS_WINRT)
-	qCritical(qPrintable(message));
+	if (type == UsageMessage)
+		qInfo(qPrintable(message));
+	else
+		qCritical(qPrintable(message));
 	return;
 #elif defined(Q_OS_WIN) && !defined(QT_BOOTSTRAPPED)
 	if (displayMessageBox()) {
-		const UINT flags = MB_OK | MB_TOPMOST | MB_SETFOREGROUND | MB_ICONERROR;
+		const UINT flags = MB_OK | MB_TOPMOST | MB_SETFOREGROUND |
+						   (type == UsageMessage ? MB_ICONINFORMATION : MB_ICONERROR);
 		QString title;
 		if (QCoreApplication::instance())
 			title = QCoreApplication::instance()->property("applicationDisplayName").toString();
@@ -42,9 +73,111 @@ void showParserMessage(const QString &message)
 		return;
 	}
 #endif // Q_OS_WIN && !QT_BOOTSTRAPPED
-	fputs(qPrintable(message), stderr);
+	fputs(qPrintable(message), type == UsageMessage ? stdout : stderr);
+}
+
+bool isContextNode(const QCliNode *node)
+{
+	return dynamic_cast<const QCliContext*>(node);
+}
+
+bool isLeafNode(const QCliNode *node)
+{
+	return dynamic_cast<const QCliLeaf*>(node);
+}
+
+bool isContextNode(const QCliStaticNode *node)
+{
+	return node->type == QCliStaticNode::Context;
+}
+
+bool isLeafNode(const QCliStaticNode *node)
+{
+	return node->type == QCliStaticNode::Leaf;
+}
+
+QCommandLineOption staticOption(const QCliStaticOption &staticOption)
+{
+	QCommandLineOption option {
+		QString::fromLatin1(staticOption.names).split(QLatin1Char('|')),
+		QString::fromUtf8(staticOption.description),
+		QString::fromLatin1(staticOption.valueName),
+		QString::fromUtf8(staticOption.defaultValue)
+	};
+	if(staticOption.hidden)
+		option.setFlags(QCommandLineOption::HiddenFromHelp);
+	return option;
+}
+
+int optionNameLength(const QCliArgument &argument, int from)
+{
+	// equivalent of argument.mid(from).section(QLatin1Char('='), 0, 0).size()
+	const auto assignPos = argument.indexOf('=', from);
+	return (assignPos == -1 ? argument.size() : assignPos) - from;
+}
+
+}
+
+
+
+// state of a single parse run. The argument list is never copied. Instead, commands that have been
+// consumed by a context are only marked as removed, and all arguments that could be options are
+// indexed once, so that contexts can skip over long runs of positional arguments
+struct QCliParser::ParseState
+{
+	ParseState(const QCliArgumentList &arguments, QCliParseResult &result);
+
+	const QCliArgumentList &arguments;
+	QCliParseResult &result;
+	QBitArray removed;
+	QVector<int> optionIndexes;
+	int argumentCount;
+	int firstPositional;
+
+	int nextIndex(int index) const;
+	int nextOptionIndex(int index) const;
+	void removeOne(const QString &argument);
+};
+
+QCliParser::ParseState::ParseState(const QCliArgumentList &arguments, QCliParseResult &result) :
+	arguments(arguments),
+	result(result),
+	removed(arguments.size()),
+	optionIndexes(),
+	argumentCount(arguments.size()),
+	firstPositional(-1)
+{
+	for(auto i = 0; i < arguments.size(); i++) {
+		if(arguments.at(i).at(0) == '-')
+			optionIndexes.append(i);
+	}
+}
+
+int QCliParser::ParseState::nextIndex(int index) const
+{
+	do
+		index++;
+	while(index < arguments.size() && removed.testBit(index));
+	return index;
+}
+
+int QCliParser::ParseState::nextOptionIndex(int index) const
+{
+	auto it = std::upper_bound(optionIndexes.constBegin(), optionIndexes.constEnd(), index);
+	while(it != optionIndexes.constEnd() && removed.testBit(*it))
+		++it;
+	return it == optionIndexes.constEnd() ? arguments.size() : *it;
 }
 
+void QCliParser::ParseState::removeOne(const QString &argument)
+{
+	for(auto i = nextIndex(-1); i < arguments.size(); i = nextIndex(i)) {
+		if(arguments.at(i) == argument) {
+			removed.setBit(i);
+			argumentCount--;
+			return;
+		}
+	}
 }
 
 
@@ -52,18 +185,223 @@ void showParserMessage(const QString &message)
 QCliParser::QCliParser() :
 	QCommandLineParser(),
 	QCliContext(),
-	_contextChain(),
-	_errorText(),
-	_readContextIndex(-1)
+	_singleDashWordOptionMode(ParseAsCompactedShortOptions),
+	_optionsAfterPositionalArgumentsMode(ParseAsOptions),
+	_responseFileMode(NoResponseFiles),
+	_builtinOptions(),
+	_frozenTree(),
+	_staticSchema(nullptr),
+	_schemaImage(),
+	_completionEnabled(false),
+	_completionIndexFile(),
+	_nodeArena(),
+	_result(),
+	_suggestionMutex(),
+	_suggestionIndexes(),
+	_staticOptionMutex(),
+	_staticOptions(),
+	_descriptionCatalog(),
+	_helpMutex(),
+	_catalogLoaded(false),
+	_catalog(),
+	_helpTexts(),
+	_completerMutex(),
+	_completer()
 {}
 
+QCliParser::QCliParser(const QCliStaticNode &staticSchema) :
+	QCliParser()
+{
+	Q_ASSERT_X(QCliStatic::isValid(staticSchema), Q_FUNC_INFO, "Invalid static schema");
+	_staticSchema = &staticSchema;
+}
+
+QCliParser::~QCliParser()
+{
+	// the root context still references the arena nodes, but only releases them (no-op deleters)
+	_nodeArena.reset();
+}
+
+void QCliParser::setSingleDashWordOptionMode(SingleDashWordOptionMode parsingMode)
+{
+	QCommandLineParser::setSingleDashWordOptionMode(parsingMode);
+	_singleDashWordOptionMode = parsingMode;
+	resetCompleter();
+}
+
+void QCliParser::setOptionsAfterPositionalArgumentsMode(OptionsAfterPositionalArgumentsMode parsingMode)
+{
+	QCommandLineParser::setOptionsAfterPositionalArgumentsMode(parsingMode);
+	_optionsAfterPositionalArgumentsMode = parsingMode;
+}
+
+void QCliParser::setResponseFileMode(ResponseFileMode mode)
+{
+	_responseFileMode = mode;
+}
+
+QCliParser::ResponseFileMode QCliParser::responseFileMode() const
+{
+	return _responseFileMode;
+}
+
+void QCliParser::setNodeArenaEnabled(bool enabled)
+{
+	Q_ASSERT_X(_nodes.isEmpty(), Q_FUNC_INFO, "The node arena must be set up before any nodes are added");
+	if(enabled == isNodeArenaEnabled())
+		return;
+	_nodeArena.reset(enabled ? new QCliNodeArena{} : nullptr);
+	_arena = _nodeArena.data();
+}
+
+bool QCliParser::isNodeArenaEnabled() const
+{
+	return !_nodeArena.isNull();
+}
+
+QCommandLineOption QCliParser::addVersionOption()
+{
+	auto option = QCommandLineParser::addVersionOption();
+	_builtinOptions.append(option);
+	_frozenTree.reset();
+	resetCompleter();
+	return option;
+}
+
+QCommandLineOption QCliParser::addHelpOption()
+{
+	auto option = QCommandLineParser::addHelpOption();
+	_builtinOptions.append(option);
+	_frozenTree.reset();
+	resetCompleter();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+	_builtinOptions.append(QCommandLineOption {
+							   QStringLiteral("help-all"),
+							   QCommandLineParser::tr("Displays help including Qt specific options.")
+						   });
+#endif
+	return option;
+}
+
+QCommandLineOption QCliParser::addBatchOption()
+{
+	QCommandLineOption option {
+		QStringLiteral("batch"),
+		tr("Reads command lines from <file> (or stdin, if <file> is \"-\") and executes each of them."),
+		tr("file")
+	};
+	_builtinOptions.append(option);
+	_builtinOptions.append(QCommandLineOption {
+							   QStringLiteral("batch-null"),
+							   tr("Command lines in the batch file are separated by NUL characters instead of newlines.")
+						   });
+	_frozenTree.reset();
+	resetCompleter();
+	return option;
+}
+
+QCommandLineOption QCliParser::addCompletionOption()
+{
+	QCommandLineOption option {
+		QStringLiteral("completion-script"),
+		tr("Prints the completion script for <shell> (bash, zsh or fish)."),
+		tr("shell")
+	};
+	_builtinOptions.append(option);
+	_completionEnabled = true;
+	_frozenTree.reset();
+	resetCompleter();
+	return option;
+}
+
 void QCliParser::process(const QStringList &arguments, bool colored)
 {
-	if(parse(arguments)) {
-		if(QCommandLineParser::isSet(QStringLiteral("help")))
-			showHelp(EXIT_SUCCESS);
-		if(QCommandLineParser::isSet(QStringLiteral("version")))
-			showVersion();
+	auto exitCode = EXIT_SUCCESS;
+	if(!tryProcess(arguments, exitCode, colored)) {
+		qt_call_post_routines();
+		::exit(exitCode);
+	}
+}
+
+bool QCliParser::tryProcess(const QStringList &arguments, int &exitCode, bool colored)
+{
+	// called by the completion scripts as: <program> --__complete <current word index> <words...>
+	if(_completionEnabled && arguments.value(1) == QStringLiteral("--__complete")) {
+		const auto candidates = completions(arguments.mid(3), arguments.value(2).toInt());
+		if(!candidates.isEmpty())
+			fputs(qPrintable(candidates.join(QLatin1Char('\n')) + QLatin1Char('\n')), stdout);
+		fflush(stdout);
+		// the resolver only asks the application if the index is missing, outdated or hit a lazy node
+		if(!_completionIndexFile.isEmpty())
+			writeCompletionIndex(_completionIndexFile);
+		exitCode = EXIT_SUCCESS;
+		return false;
+	}
+
+	parse(arguments);
+	return processResult(arguments.value(0), colored, exitCode);
+}
+
+void QCliParser::process(const QCoreApplication &app, bool colored)
+{
+	Q_UNUSED(app)
+	process(QCoreApplication::arguments(), colored);
+}
+
+void QCliParser::process(int argc, const char *const *argv, bool colored)
+{
+	// completion requests are rare and small -> no need for a zero-copy path
+	if(_completionEnabled && argc > 1 && qstrcmp(argv[1], "--__complete") == 0) {
+		QStringList arguments;
+		arguments.reserve(argc);
+		for(auto i = 0; i < argc; i++)
+			arguments.append(QString::fromLocal8Bit(argv[i]));
+		process(arguments, colored);
+		return;
+	}
+
+	parse(argc, argv);
+	auto exitCode = EXIT_SUCCESS;
+	if(!processResult(argc > 0 ? QString::fromLocal8Bit(argv[0]) : QString(), colored, exitCode)) {
+		qt_call_post_routines();
+		::exit(exitCode);
+	}
+}
+
+bool QCliParser::processResult(const QString &program, bool colored, int &exitCode)
+{
+	// everything the parser answers on its own is written here. Returns false if that completed the command
+	if(_result._valid) {
+		exitCode = EXIT_SUCCESS;
+		// like QCommandLineParser, GUI applications on windows show help and version in a message box
+		if(isBuiltinSet(QStringLiteral("help"))) {
+			::showParserMessage(helpText(), UsageMessage);
+			fflush(stdout);
+			return false;
+		}
+		if(isBuiltinSet(QStringLiteral("version"))) {
+			::showParserMessage(QCoreApplication::applicationName() + QLatin1Char(' ') +
+								QCoreApplication::applicationVersion() + QLatin1Char('\n'),
+								UsageMessage);
+			fflush(stdout);
+			return false;
+		}
+		if(isBuiltinSet(QStringLiteral("completion-script"))) {
+			const auto shell = value(QStringLiteral("completion-script"));
+			auto indexFile = _completionIndexFile;
+			if(!indexFile.isEmpty() && !writeCompletionIndex(indexFile))
+				indexFile.clear();
+			const auto script = completionScript(shell, QFileInfo{program}.fileName(), indexFile);
+			if(script.isEmpty()) {
+				showParserMessage(tr("Unsupported shell \"%1\" - must be one of bash, zsh or fish\n").arg(shell));
+				exitCode = EXIT_FAILURE;
+				return false;
+			}
+			fputs(qPrintable(script), stdout);
+			fflush(stdout);
+			return false;
+		}
+		return true;
 	} else {
 #ifdef Q_OS_WIN
 		Q_UNUSED(colored)
@@ -73,80 +411,453 @@ void QCliParser::process(const QStringList &arguments, bool colored)
 		else
 #endif
 			showParserMessage(errorText() + QLatin1Char('\n'));
-		qt_call_post_routines();
-		::exit(EXIT_FAILURE);
+		exitCode = EXIT_FAILURE;
+		return false;
 	}
 }
 
-void QCliParser::process(const QCoreApplication &app, bool colored)
+bool QCliParser::parse(const QStringList &arguments)
 {
-	Q_UNUSED(app)
-	process(QCoreApplication::arguments(), colored);
+	_result = parseArguments(arguments);
+	return _result._valid;
 }
 
-bool QCliParser::parse(const QStringList &arguments)
+bool QCliParser::parse(int argc, const char *const *argv)
 {
-#ifndef QT_NO_DEBUG
-	if(_readContextIndex != -1) {
-		qWarning() << "Parser is currently in context scope. "
-					  "Parsing different arguments then before can lead to undefined behaviour!";
-	}
-#endif
-	_errorText.clear();
+	_result = parseArguments(argc, argv);
+	return _result._valid;
+}
+
+void QCliParser::reset()
+{
+	// drop everything the previous parse run left behind, so the parser can be reused
+	_result = QCliParseResult{};
+}
+
+QCliParseResult QCliParser::parseArguments(const QStringList &arguments) const
+{
+	return parseArgumentList(QSharedPointer<QCliArgumentList>::create(arguments));
+}
+
+QCliParseResult QCliParser::parseArguments(int argc, const char *const *argv) const
+{
+	// argv is neither copied nor converted. Only the values that are read later are
+	return parseArgumentList(QSharedPointer<QCliArgumentList>::create(argc, argv));
+}
+
+QCliParseResult QCliParser::parseArgumentList(const QSharedPointer<QCliArgumentList> &arguments) const
+{
+	QCliParseResult result;
+	result._arguments = arguments;
+	result._builtinOptionCount = _builtinOptions.size();
+	result._frozenTree = _frozenTree;
+	result._frozenNode = _frozenTree ? 0 : -1;
+	if(result._frozenNode == -1)
+		result.registerOptions(_builtinOptions);
 	try {
-		parseContext(this, arguments);
-		return true;
+		QString responseFileError;
+		if(_responseFileMode != NoResponseFiles &&
+		   !arguments->expandResponseFiles(_responseFileMode == NullSeparatedResponseFiles ? '\0' : '\n', &responseFileError))
+			throw tr("Failed to read response file %1").arg(responseFileError);
+		ParseState state{*arguments, result};
+		if(_staticSchema)
+			parseNode(_staticSchema, state);
+		else
+			parseNode<QCliNode>(this, state);
+		result._valid = true;
 	} catch (QString &string) {
-		if(_contextChain.isEmpty())
-			_errorText = string;
+		if(result._contextChain.isEmpty())
+			result._errorText = string;
 		else {
-			_errorText = tr("%1\nCommand-Context: %2")
-						 .arg(string, _contextChain.join(QStringLiteral(" -> ")));
+			result._errorText = tr("%1\nCommand-Context: %2")
+								.arg(string, result._contextChain.join(QStringLiteral(" -> ")));
 		}
+	}
+	return result;
+}
+
+QCliParseResult QCliParser::parseResult() const
+{
+	return _result;
+}
+
+void QCliParser::freeze()
+{
+	// a static schema is already flat and sorted
+	if(_staticSchema)
+		return;
+	_frozenTree.reset(new QCliFrozenTree{this, _builtinOptions});
+	resetCompleter();
+	QMutexLocker locker{&_helpMutex};
+	_helpTexts.clear();
+}
+
+bool QCliParser::isFrozen() const
+{
+	return !_frozenTree.isNull();
+}
+
+bool QCliParser::writeSchemaImage(const QString &fileName, quint32 revision) const
+{
+	QString error;
+	QByteArray image;
+	if(_staticSchema)
+		error = tr("Only trees created at runtime can be written as an image");
+	else
+		image = QCliSchemaImage::create(this, revision, &error);
+
+	QSaveFile file{fileName};
+	if(!error.isEmpty() ||
+	   !file.open(QIODevice::WriteOnly) ||
+	   file.write(image) != image.size() ||
+	   !file.commit()) {
+		qWarning("QCliParser: failed to write schema image \"%ls\": %ls",
+				 qUtf16Printable(fileName),
+				 qUtf16Printable(error.isEmpty() ? file.errorString() : error));
 		return false;
 	}
+	return true;
 }
 
-bool QCliParser::enterContext(const QString &name)
+bool QCliParser::loadSchemaImage(const QString &fileName, quint32 revision)
 {
-	auto nIndex = _readContextIndex + 1;
-	if(nIndex < 0 ||
-	   nIndex >= _contextChain.size())
+	QScopedPointer<QCliSchemaImage> image{new QCliSchemaImage{}};
+	QString error;
+	if(!image->load(fileName, revision, &error)) {
+		// a missing image is the normal first run, so this is only a debug message
+		qCDebug(cliParser, "Not using schema image \"%ls\": %ls",
+				qUtf16Printable(fileName),
+				qUtf16Printable(error));
 		return false;
+	}
 
-	if(_contextChain[nIndex] == name) {
-		_readContextIndex++;
-		return true;
-	} else
+	// from now on, the image replaces the tree of this context
+	_staticSchema = image->root();
+	_schemaImage.swap(image);
+	_frozenTree.reset();
+	resetCompleter();
+	_result = QCliParseResult{};
+	{
+		QMutexLocker locker{&_suggestionMutex};
+		_suggestionIndexes.clear();
+	}
+	{
+		QMutexLocker locker{&_staticOptionMutex};
+		_staticOptions.clear();
+	}
+	QMutexLocker locker{&_helpMutex};
+	_helpTexts.clear();
+	return true;
+}
+
+bool QCliParser::isSet(const QString &name) const
+{
+	return _result.isSet(name);
+}
+
+QString QCliParser::value(const QString &name) const
+{
+	return _result.value(name);
+}
+
+QStringList QCliParser::values(const QString &name) const
+{
+	return _result.values(name);
+}
+
+bool QCliParser::isSet(const QCommandLineOption &option) const
+{
+	return _result.isSet(option);
+}
+
+QString QCliParser::value(const QCommandLineOption &option) const
+{
+	return _result.value(option);
+}
+
+QStringList QCliParser::values(const QCommandLineOption &option) const
+{
+	return _result.values(option);
+}
+
+bool QCliParser::isSet(const QCliOptionHandle &option) const
+{
+	return _result.isSet(option);
+}
+
+QString QCliParser::value(const QCliOptionHandle &option) const
+{
+	return _result.value(option);
+}
+
+QStringList QCliParser::values(const QCliOptionHandle &option) const
+{
+	return _result.values(option);
+}
+
+QVariant QCliParser::typedValue(const QString &name) const
+{
+	return _result.typedValue(name);
+}
+
+QVariantList QCliParser::typedValues(const QString &name) const
+{
+	return _result.typedValues(name);
+}
+
+QVariant QCliParser::typedValue(const QCliOptionHandle &option) const
+{
+	return _result.typedValue(option);
+}
+
+QVariantList QCliParser::typedValues(const QCliOptionHandle &option) const
+{
+	return _result.typedValues(option);
+}
+
+QVariant QCliParser::typedPositionalArgument(int index) const
+{
+	return _result.typedPositionalArgument(index);
+}
+
+QStringList QCliParser::positionalArguments() const
+{
+	return _result.positionalArguments();
+}
+
+int QCliParser::positionalArgumentCount() const
+{
+	return _result.positionalArgumentCount();
+}
+
+QString QCliParser::positionalArgument(int index) const
+{
+	return _result.positionalArgument(index);
+}
+
+QByteArray QCliParser::positionalArgumentUtf8(int index) const
+{
+	return _result.positionalArgumentUtf8(index);
+}
+
+QCliPositionalRange QCliParser::positionalRange(int first) const
+{
+	return _result.positionalRange(first);
+}
+
+QStringList QCliParser::optionNames() const
+{
+	return _result.optionNames();
+}
+
+QStringList QCliParser::unknownOptionNames() const
+{
+	return _result.unknownOptionNames();
+}
+
+void QCliParser::showHelp(int exitCode)
+{
+	// like QCommandLineParser, GUI applications on windows show the help in a message box
+	::showParserMessage(helpText(), UsageMessage);
+	fflush(stdout);
+	qt_call_post_routines();
+	::exit(exitCode);
+}
+
+QString QCliParser::helpText() const
+{
+	// frozen and static trees cannot change anymore, so their help texts only need to be built once
+	const auto cacheable = _frozenTree || _staticSchema;
+	if(cacheable) {
+		QMutexLocker locker{&_helpMutex};
+		const auto it = _helpTexts.constFind(_result._contextChain);
+		if(it != _helpTexts.constEnd() && it->applicationDescription == applicationDescription())
+			return it->text;
+	}
+
+	QCommandLineParser helpParser;
+	prepareHelp(helpParser);
+	const auto text = helpParser.helpText();
+	if(cacheable) {
+		QMutexLocker locker{&_helpMutex};
+		_helpTexts.insert(_result._contextChain, HelpText{applicationDescription(), text});
+	}
+	return text;
+}
+
+void QCliParser::setDescriptionCatalog(const QString &fileNamePattern)
+{
+	QMutexLocker locker{&_helpMutex};
+	_descriptionCatalog = fileNamePattern;
+	_catalogLoaded = false;
+	_catalog.reset();
+	_helpTexts.clear();
+}
+
+QString QCliParser::descriptionCatalog() const
+{
+	return _descriptionCatalog;
+}
+
+bool QCliParser::writeDescriptionCatalog(const QString &fileName) const
+{
+	QHash<QString, QString> descriptions;
+	if(!applicationDescription().isEmpty())
+		descriptions.insert(QString{}, applicationDescription());
+	if(_staticSchema)
+		collectDescriptions(_staticSchema, {}, descriptions);
+	else
+		collectDescriptions(this, {}, descriptions);
+
+	QSaveFile file{fileName};
+	if(!file.open(QIODevice::WriteOnly)) {
+		qWarning().noquote() << "Failed to write description catalog" << fileName << "with error:" << file.errorString();
 		return false;
+	}
+	file.write(QCliDescriptionCatalog::serialize(descriptions));
+	return file.commit();
+}
+
+bool QCliParser::enterContext(const QString &name)
+{
+	return _result.enterContext(name);
 }
 
 QString QCliParser::currentContext() const
 {
-	if(_readContextIndex < 0 ||
-	   _readContextIndex >= _contextChain.size())
-		return {};
-	else
-		return _contextChain[_readContextIndex];
+	return _result.currentContext();
 }
 
 bool QCliParser::leaveContext()
 {
-	if(_readContextIndex >= 0) {
-		_readContextIndex--;
-		return true;
-	} else
-		return false;
+	return _result.leaveContext();
 }
 
 QStringList QCliParser::contextChain() const
 {
-	return _contextChain;
+	return _result.contextChain();
 }
 
 QString QCliParser::errorText() const
 {
-	return _errorText;
+	return _result.errorText();
+}
+
+QStringList QCliParser::completions(const QStringList &words, int currentWord) const
+{
+	// like the help texts, the tries of frozen and static trees only need to be built once
+	if(!_frozenTree && !_staticSchema) {
+		QCliCompleter completer{_builtinOptions, _singleDashWordOptionMode};
+		return completer.complete(this, words, currentWord);
+	}
+
+	QMutexLocker locker{&_completerMutex};
+	if(!_completer)
+		_completer.reset(new QCliCompleter{_builtinOptions, _singleDashWordOptionMode});
+	if(_staticSchema)
+		return _completer->complete(_staticSchema, words, currentWord);
+	else
+		return _completer->complete(this, words, currentWord);
+}
+
+void QCliParser::resetCompleter()
+{
+	QMutexLocker locker{&_completerMutex};
+	_completer.reset();
+}
+
+QString QCliParser::completionScript(const QString &shell, const QString &programName, const QString &indexFile)
+{
+	return QCliCompleter::script(shell,
+								 programName.isEmpty() ? QCoreApplication::applicationName() : programName,
+								 indexFile.isEmpty() ? QString() : QFileInfo{indexFile}.absoluteFilePath());
+}
+
+void QCliParser::setCompletionIndexFile(const QString &fileName)
+{
+	_completionIndexFile = fileName;
+}
+
+QString QCliParser::completionIndexFile() const
+{
+	return _completionIndexFile;
+}
+
+bool QCliParser::writeCompletionIndex(const QString &fileName) const
+{
+	// the binary is only known with an application object. Without it, resolvers cannot check the age of the index
+	const auto program = QCoreApplication::instance() ?
+							 QFileInfo{QCoreApplication::applicationFilePath()} :
+							 QFileInfo{};
+	QCliCompleter completer{_builtinOptions, _singleDashWordOptionMode};
+	const auto index = _staticSchema ?
+						   completer.createIndex(_staticSchema, program) :
+						   completer.createIndex(this, program);
+
+	// the header contains the schema hash and the binary's timestamp - if they match, the file is up to date
+	QFile existing{fileName};
+	if(existing.open(QIODevice::ReadOnly) &&
+	   existing.size() == index.size() &&
+	   existing.read(sizeof(QCliIndexHeader)) == index.left(sizeof(QCliIndexHeader)))
+		return true;
+	existing.close();
+
+	QSaveFile file{fileName};
+	if(!file.open(QIODevice::WriteOnly) ||
+	   file.write(index) != index.size() ||
+	   !file.commit()) {
+		qWarning("QCliParser: failed to write completion index \"%ls\": %ls",
+				 qUtf16Printable(fileName),
+				 qUtf16Printable(file.errorString()));
+		return false;
+	}
+	return true;
+}
+
+QStringList QCliParser::splitCommandLine(const QString &commandLine, bool *ok)
+{
+	// splits like a POSIX shell: whitespace separates arguments, single quotes keep everything
+	// literal, backslashes escape the next character (inside double quotes only " \ $ and `)
+	QStringList arguments;
+	QString current;
+	auto inArgument = false;
+	QChar quote;
+	for(auto i = 0; i < commandLine.size(); i++) {
+		const auto c = commandLine[i];
+		if(quote == QLatin1Char('\'')) {
+			if(c == QLatin1Char('\''))
+				quote = QChar{};
+			else
+				current.append(c);
+		} else if(c == QLatin1Char('\\') && i + 1 < commandLine.size() &&
+				  (quote.isNull() || QStringLiteral("\"\\$`").contains(commandLine[i + 1]))) {
+			current.append(commandLine[++i]);
+			inArgument = true;
+		} else if(quote == QLatin1Char('"')) {
+			if(c == QLatin1Char('"'))
+				quote = QChar{};
+			else
+				current.append(c);
+		} else if(c == QLatin1Char('\'') || c == QLatin1Char('"')) {
+			quote = c;
+			inArgument = true;
+		} else if(c.isSpace()) {
+			if(inArgument) {
+				arguments.append(current);
+				current.clear();
+				inArgument = false;
+			}
+		} else {
+			current.append(c);
+			inArgument = true;
+		}
+	}
+	if(inArgument)
+		arguments.append(current);
+
+	if(ok)
+		*ok = quote.isNull();
+	return arguments;
 }
 
 void QCliParser::showParserMessage(const QString &message)
@@ -167,98 +878,674 @@ void QCliParser::clearPositionalArguments()
 	Q_UNREACHABLE();
 }
 
-void QCliParser::parseContext(QCliContext *context, QStringList arguments)
+template <typename TNode>
+void QCliParser::parseNode(const TNode *node, ParseState &state) const
 {
-	Q_ASSERT_X(!context->_nodes.isEmpty(),
-			   Q_FUNC_INFO,
-			   qPrintable(QStringLiteral("A QCliContext must have at least 1 node. At chain: %1")
-						  .arg(_contextChain.join(QStringLiteral("->")))));
-
-	// reset args + add options
-	QCommandLineParser::clearPositionalArguments();
-	QCommandLineParser::addOptions(context->_options);
+	// add options
+	enterNode(node, state);
 
-	//create positional args
-	auto commands = context->_nodes.keys();
-	QStringList printArgs;
-	for(const auto &command : commands) {
-		if(!context->_nodes.value(command).second->isHidden())
-			printArgs.append(command);
-	}
-	auto firstName = printArgs.first();
-	auto pFirstName = firstName;
-	if(firstName == context->_defaultNode)
-		pFirstName = tr("%1 (default)").arg(firstName);
-	QCommandLineParser::addPositionalArgument(pFirstName,
-											  context->_nodes.value(firstName).first,
-											  (context->_defaultNode.isNull() ? QStringLiteral("%1%2%3") : QStringLiteral("%1%2[%3]"))
-											  .arg(_contextChain.join(QLatin1Char(' ')),
-												   _contextChain.isEmpty() ? QString() : QStringLiteral(" "),
-												   printArgs.join(QLatin1Char('|'))));
-	for(auto i = 1; i < printArgs.size(); i++) {
-		auto name = printArgs[i];
-		auto pName = name;
-		if(name == context->_defaultNode)
-			pName = tr("%1 (default)").arg(name);
-		QCommandLineParser::addPositionalArgument(pName, context->_nodes.value(name).first, QStringLiteral(" \b"));
-	}
+	if(isLeafNode(node)) {
+		//parse completly now, must be valid!
+		if(!scanArguments(state, true))
+			throw unknownOptionText(state.result);
+		// no need to validate a command that only shows its help
+		if(!state.result.isBuiltinSet(QStringLiteral("help")))
+			convertValues(node, state.result);
+		return;
+	} else if(!isContextNode(node))
+		throw tr("Unknown QCliNode type. Must be QCliContext or QCliLeaf");
 
-	// parse . if no errors and version -> done
-	if(QCommandLineParser::parse(arguments) &&
-	   QCommandLineParser::isSet(QStringLiteral("version")))
+	// parse . if no errors and version or batch -> done
+	if(scanArguments(state, false) &&
+	   (state.result.isBuiltinSet(QStringLiteral("version")) ||
+		state.result.isBuiltinSet(QStringLiteral("batch")) ||
+		state.result.isBuiltinSet(QStringLiteral("completion-script")))) {
+		scanArguments(state, true);
 		return;
+	}
 	//ignore errors, only treated on leafs
 
 	//determine the selected command
-	auto pArgs = QCommandLineParser::positionalArguments();
-	auto cIndex = -1;
-	if(!pArgs.isEmpty()) {
-		cIndex = commands.indexOf(pArgs.first());
-		if(cIndex == -1)
-			throw tr("Unknown command \"%1\"").arg(pArgs.first());
+	QString nextContext;
+	const TNode *nextNode = nullptr;
+	if(state.firstPositional != -1) {
+		nextContext = state.arguments.toString(state.firstPositional);
+		nextNode = findNode(node, nextContext, state);
+		if(!nextNode) {
+			scanArguments(state, true);
+			auto message = tr("Unknown command \"%1\"").arg(nextContext);
+			const auto suggestions = commandSuggestions(node, nextContext);
+			if(!suggestions.isEmpty())
+				message += QLatin1Char('\n') + tr("Did you mean \"%1\"?").arg(suggestions.join(QStringLiteral("\", \"")));
+			throw message;
+		}
 	} else {
-		if(QCommandLineParser::isSet(QStringLiteral("help")))
+		if(state.result.isBuiltinSet(QStringLiteral("help"))) {
+			scanArguments(state, true);
 			return;
-		cIndex = commands.indexOf(context->_defaultNode);
-		if(cIndex == -1)
+		}
+		nextContext = defaultNodeName(node);
+		nextNode = findNode(node, nextContext, state);
+		if(!nextNode) {
+			scanArguments(state, true);
 			throw tr("A command must be specified");
+		}
+	}
+
+	// get the next node and continue with it
+	state.result._contextChain.append(nextContext);
+	state.removeOne(nextContext); //remove the command from the args list, as it is already processed
+	parseNode(nextNode, state);
+}
+
+void QCliParser::enterNode(const QCliNode *node, ParseState &state) const
+{
+	if(const auto context = dynamic_cast<const QCliContext*>(node)) {
+		context->createLazyNodes();
+		Q_ASSERT_X(!context->_nodes.isEmpty(),
+				   Q_FUNC_INFO,
+				   qPrintable(QStringLiteral("A QCliContext must have at least 1 node. At chain: %1")
+							  .arg(state.result._contextChain.join(QStringLiteral("->")))));
+	}
+
+	state.result.registerNodeOptions(node);
+	state.result._helpNode = node;
+	state.result._staticHelpNode = nullptr;
+}
+
+void QCliParser::enterNode(const QCliStaticNode *node, ParseState &state) const
+{
+	Q_ASSERT_X(node->type == QCliStaticNode::Leaf || node->childCount > 0,
+			   Q_FUNC_INFO,
+			   qPrintable(QStringLiteral("A QCliContext must have at least 1 node. At chain: %1")
+						  .arg(state.result._contextChain.join(QStringLiteral("->")))));
+
+	state.result.registerOptions(staticNodeOptions(node));
+	state.result._helpNode = nullptr;
+	state.result._staticHelpNode = node;
+}
+
+QList<QCommandLineOption> QCliParser::staticNodeOptions(const QCliStaticNode *node) const
+{
+	// the static data never changes, so every node's options are only created once. The list is
+	// implicitly shared with the parse results
+	if(node->optionCount == 0)
+		return {};
+	QMutexLocker locker{&_staticOptionMutex};
+	auto it = _staticOptions.find(node);
+	if(it == _staticOptions.end()) {
+		QList<QCommandLineOption> options;
+		options.reserve(node->optionCount);
+		for(auto i = 0; i < node->optionCount; i++)
+			options.append(staticOption(node->options[i]));
+		it = _staticOptions.insert(node, options);
 	}
+	return *it;
+}
+
+const QCliNode *QCliParser::findNode(const QCliNode *node, const QString &name, ParseState &state) const
+{
+	if(state.result._frozenNode != -1) {
+		const auto nodeIndex = _frozenTree->findChild(state.result._frozenNode, name);
+		if(nodeIndex == -1)
+			return nullptr;
+		if(_frozenTree->isLazy(nodeIndex)) {
+			// lazy contexts are not part of the frozen tree -> continue with the live tree
+			QList<QCommandLineOption> options;
+			options.reserve(_frozenTree->optionCount(nodeIndex));
+			for(auto i = 0; i < _frozenTree->optionCount(nodeIndex); i++)
+				options.append(_frozenTree->option(nodeIndex, i));
+			state.result._optionList.clear();
+			state.result._nameHash.clear();
+			state.result.registerOptions(options);
+			state.result._frozenNode = -1;
+		} else
+			state.result._frozenNode = nodeIndex;
+		return _frozenTree->node(nodeIndex);
+	} else {
+		const auto context = static_cast<const QCliContext*>(node);
+		const auto it = context->_nodes.constFind(name);
+		if(it == context->_nodes.constEnd())
+			return nullptr;
+		return it->second.data();
+	}
+}
 
-	// get the next node and it's type
-	auto nextContext = commands[cIndex];
-	_contextChain.append(nextContext);
-	arguments.removeOne(nextContext); //remove the command from the args list, as it is already processed
-	auto nextNode = context->_nodes.value(nextContext).second;
+const QCliStaticNode *QCliParser::findNode(const QCliStaticNode *node, const QString &name, ParseState &state) const
+{
+	Q_UNUSED(state)
+	if(name.isNull())
+		return nullptr;
 
-	if(auto contextNode = nextNode.dynamicCast<QCliContext>())
-		parseContext(contextNode.data(), arguments);
-	else if(auto leafNode = nextNode.dynamicCast<QCliLeaf>())
-		parseLeaf(leafNode.data(), arguments);
+	// children are sorted by name -> binary search
+	auto begin = node->children;
+	auto end = node->children + node->childCount;
+	const auto it = std::lower_bound(begin, end, name, [](const QCliStaticNode &child, const QString &key) {
+		return QString::compare(QLatin1String{child.name}, key) < 0;
+	});
+	if(it != end && QLatin1String{it->name} == name)
+		return it;
 	else
-		throw tr("Unknown QCliNode type. Must be QCliContext or QCliLeaf");
+		return nullptr;
 }
 
-void QCliParser::parseLeaf(QCliLeaf *leaf, const QStringList &arguments)
+QString QCliParser::defaultNodeName(const QCliNode *node)
 {
-	// reset args + add options
-	QCommandLineParser::clearPositionalArguments();
-	QCommandLineParser::addOptions(leaf->_options);
+	return static_cast<const QCliContext*>(node)->_defaultNode;
+}
 
-	if(leaf->_arguments.isEmpty())
-		QCommandLineParser::addPositionalArgument(QStringLiteral(" "), QStringLiteral(" "), _contextChain.join(QLatin1Char(' ')));
-	else {
-		auto first = leaf->_arguments.first();
-		QCommandLineParser::addPositionalArgument(std::get<0>(first),
-												  std::get<1>(first),
-												  QStringLiteral("%1 %2")
-												  .arg(_contextChain.join(QLatin1Char(' ')), std::get<2>(first)));
-		for(auto i = 1; i < leaf->_arguments.size(); i++) {
-			const auto &pArg = leaf->_arguments[i];
-			QCommandLineParser::addPositionalArgument(std::get<0>(pArg), std::get<1>(pArg), std::get<2>(pArg));
+QString QCliParser::defaultNodeName(const QCliStaticNode *node)
+{
+	return QString::fromLatin1(node->defaultNode);
+}
+
+void QCliParser::convertValues(const QCliNode *node, QCliParseResult &result) const
+{
+	result._typedOptionValues.clear();
+	result._typedPositionalArguments.clear();
+
+	// typed options of all entered nodes, resolved in the registry of the leaf
+	for(const auto &entry : qAsConst(result._nodeOptions)) {
+		const auto &specs = entry.node->_optionSpecs;
+		for(auto it = specs.constBegin(); it != specs.constEnd(); ++it) {
+			const auto index = result.optionIndex(entry.node, it.key());
+			if(index == -1) // skipped as duplicate
+				continue;
+			const auto &option = result.optionAt(index);
+			const auto names = option.names();
+			const auto &spec = *it;
+
+			// options without a value can only be counted by their names
+			const auto count = option.valueName().isEmpty() ?
+								   static_cast<int>(std::count_if(result._optionNames.constBegin(), result._optionNames.constEnd(), [&](const QString &name) {
+									   return names.contains(name);
+								   })) :
+								   result._optionValues.value(index).size();
+			if(count < spec.minCount) {
+				throw spec.minCount == 1 ?
+					tr("Missing required option '%1'").arg(names.first()) :
+					tr("Option '%1' must be given at least %L2 times").arg(names.first()).arg(spec.minCount);
+			}
+			if(spec.maxCount != -1 && count > spec.maxCount) {
+				throw spec.maxCount == 1 ?
+					tr("Option '%1' can only be given once").arg(names.first()) :
+					tr("Option '%1' can be given at most %L2 times").arg(names.first()).arg(spec.maxCount);
+			}
+			if(option.valueName().isEmpty())
+				continue;
+
+			QVariantList typedValues;
+			for(const auto &text : result.valuesAt(index)) { // includes the default values
+				QVariant value;
+				if(!spec.type.convert(text, value))
+					throw tr("Invalid value \"%1\" for option '%2' - expected %3").arg(text, names.first(), spec.type.description());
+				typedValues.append(value);
+			}
+			result._typedOptionValues.insert(index, typedValues);
+		}
+	}
+
+	const auto leaf = static_cast<const QCliLeaf*>(node);
+	if(!leaf->_typedArguments)
+		return;
+
+	// every argument gets its minimum count, the remaining ones go to the first arguments that take more
+	const auto argCount = result._positionalArguments.size();
+	auto remaining = argCount;
+	for(const auto &spec : leaf->_argumentSpecs)
+		remaining -= spec.minCount;
+	if(remaining < 0)
+		throw tr("Expected at least %L1 arguments, but %L2 have been passed").arg(argCount - remaining).arg(argCount);
+
+	result._typedPositionalArguments.reserve(argCount);
+	auto argIndex = 0;
+	for(auto i = 0; i < leaf->_argumentSpecs.size(); i++) {
+		const auto &spec = leaf->_argumentSpecs[i];
+		const auto extra = spec.maxCount == -1 ? remaining : std::min(remaining, spec.maxCount - spec.minCount);
+		remaining -= extra;
+		for(auto j = 0; j < spec.minCount + extra; j++, argIndex++) {
+			const auto text = result.tokenString(result._positionalArguments[argIndex]);
+			QVariant value;
+			if(!spec.type.convert(text, value))
+				throw tr("Invalid value \"%1\" for argument %2 - expected %3").arg(text, std::get<2>(leaf->_arguments[i]), spec.type.description());
+			result._typedPositionalArguments.append(value);
+		}
+	}
+	if(remaining > 0)
+		throw tr("Expected at most %L1 arguments, but %L2 have been passed").arg(argCount - remaining).arg(argCount);
+}
+
+void QCliParser::convertValues(const QCliStaticNode *node, QCliParseResult &result) const
+{
+	// static schemas have no value types
+	Q_UNUSED(node)
+	Q_UNUSED(result)
+}
+
+bool QCliParser::scanArguments(ParseState &state, bool complete) const
+{
+	auto &result = state.result;
+	// follows the QCommandLineParser parsing rules. If not complete, only the options and the first
+	// positional argument are evaluated, and other positional arguments are skipped
+	result._optionsFound.fill(false, result.optionCount());
+	result._optionValues.clear();
+	result._optionNames.clear();
+	result._unknownOptionNames.clear();
+	result._positionalArguments.clear();
+	result._optionErrorText.clear();
+	state.firstPositional = -1;
+
+	if(state.argumentCount == 0) {
+		qWarning("QCommandLineParser: argument list cannot be empty, it should contain at least the executable name");
+		return false;
+	}
+
+	const auto &arguments = state.arguments;
+	auto error = false;
+	auto forcePositional = false;
+	QCliArgument::NameBuffer nameBuffer;
+	auto index = state.nextIndex(state.nextIndex(-1)); // skip executable name
+	while(index < arguments.size()) {
+		const auto argument = arguments.at(index);
+		auto positional = false;
+
+		if(forcePositional)
+			positional = true;
+		else if(argument.startsWith("--")) {
+			if(argument.size() > 2) {
+				const auto foundIndex = registerFoundOption(state, argument.name(2, optionNameLength(argument, 2), nameBuffer), complete);
+				if(foundIndex == -1 ||
+				   !parseOptionValue(state, foundIndex, argument, index, complete))
+					error = true;
+			} else
+				forcePositional = true;
+		} else if(argument.startsWith("-")) {
+			if(argument.size() == 1) { // single dash ("stdin")
+				if(state.firstPositional == -1)
+					state.firstPositional = index;
+				if(complete)
+					result._positionalArguments.append(QCliParseResult::Token{index, 0});
+				index = state.nextIndex(index);
+				continue;
+			}
+
+			switch(_singleDashWordOptionMode) {
+			case ParseAsCompactedShortOptions:
+			{
+				auto foundIndex = -1;
+				auto valueFound = false;
+				for(auto pos = 1; pos < argument.size(); pos = argument.nextPosition(pos)) {
+					const auto next = argument.nextPosition(pos);
+					foundIndex = registerFoundOption(state, argument.name(pos, next - pos, nameBuffer), complete);
+					if(foundIndex == -1)
+						error = true;
+					else {
+						if(!result.optionAt(foundIndex).valueName().isEmpty()) {
+							if(next < argument.size()) {
+								const auto valuePos = argument.at(next) == '=' ? next + 1 : next;
+								if(complete)
+									result._optionValues[foundIndex].append(QCliParseResult::Token{index, valuePos});
+								valueFound = true;
+							}
+							break;
+						}
+						if(argument.at(next) == '=')
+							break;
+					}
+				}
+				if(!valueFound && !parseOptionValue(state, foundIndex, argument, index, complete))
+					error = true;
+				break;
+			}
+			case ParseAsLongOptions:
+			{
+				if(argument.size() > 2) {
+					const auto shortName = argument.name(1, argument.nextPosition(1) - 1, nameBuffer);
+					const auto shortIndex = result.optionIndex(shortName);
+					if(shortIndex != -1 &&
+					   result.optionAt(shortIndex).flags().testFlag(QCommandLineOption::ShortOptionStyle)) {
+						registerFoundOption(state, shortName, complete);
+						if(complete)
+							result._optionValues[shortIndex].append(QCliParseResult::Token{index, argument.nextPosition(1)});
+						break;
+					}
+				}
+				const auto foundIndex = registerFoundOption(state, argument.name(1, optionNameLength(argument, 1), nameBuffer), complete);
+				if(foundIndex == -1 ||
+				   !parseOptionValue(state, foundIndex, argument, index, complete))
+					error = true;
+				break;
+			}
+			}
+		} else
+			positional = true;
+
+		if(positional) {
+			if(state.firstPositional == -1)
+				state.firstPositional = index;
+			if(_optionsAfterPositionalArgumentsMode == ParseAsPositionalArguments)
+				forcePositional = true;
+			if(complete)
+				result._positionalArguments.append(QCliParseResult::Token{index, 0});
+			else if(forcePositional) // only positional arguments follow
+				break;
+			else {
+				index = state.nextOptionIndex(index);
+				continue;
+			}
+		}
+
+		index = state.nextIndex(index);
+	}
+
+	return !error;
+}
+
+bool QCliParser::isBuiltinSet(const QString &name) const
+{
+	return _result.isBuiltinSet(name);
+}
+
+template <typename TNode>
+QStringList QCliParser::commandSuggestions(const TNode *node, const QString &name) const
+{
+	return findSuggestions(node, false, childCount(node), [node]() {
+		return childNames(node);
+	}, name);
+}
+
+QStringList QCliParser::optionSuggestions(const QCliParseResult &result, const QString &name) const
+{
+	// the available options only depend on the node, as every node has exactly one path
+	const void *node = result._helpNode;
+	if(!node)
+		node = result._staticHelpNode;
+	return findSuggestions(node, true, result.optionCount(), [&result]() {
+		QStringList names;
+		for(auto i = 0; i < result.optionCount(); i++) {
+			const auto &option = result.optionAt(i);
+			if(!option.flags().testFlag(QCommandLineOption::HiddenFromHelp))
+				names.append(option.names());
+		}
+		return names;
+	}, name);
+}
+
+template <typename TNames>
+QStringList QCliParser::findSuggestions(const void *key, bool options, int sourceSize, const TNames &names, const QString &word) const
+{
+	QSharedPointer<const QCliBkTree> tree;
+	{
+		QMutexLocker locker{&_suggestionMutex};
+		auto &index = _suggestionIndexes[qMakePair(key, options)];
+		// nodes and options can still be added after a parse run -> rebuild if the size changed
+		if(!index.tree || index.sourceSize != sourceSize) {
+			auto newTree = QSharedPointer<QCliBkTree>::create();
+			for(const auto &name : names())
+				newTree->insert(name);
+			index.sourceSize = sourceSize;
+			index.tree = newTree;
+		}
+		tree = index.tree;
+	}
+	return tree->find(word, QCliBkTree::maxDistanceFor(word), 3);
+}
+
+QString QCliParser::unknownOptionText(const QCliParseResult &result) const
+{
+	auto text = result.optionErrorText();
+	if(!result._optionErrorText.isEmpty())
+		return text;
+
+	const auto dashed = [this](const QString &name) {
+		if(name.size() == 1 || _singleDashWordOptionMode == ParseAsLongOptions)
+			return QString{QLatin1Char('-') + name};
+		else
+			return QString{QStringLiteral("--") + name};
+	};
+	for(const auto &unknownName : result._unknownOptionNames) {
+		// single characters are too short to guess from (and usually part of a compacted option)
+		if(unknownName.size() < 2)
+			continue;
+		QStringList candidates;
+		for(const auto &name : optionSuggestions(result, unknownName))
+			candidates.append(dashed(name));
+		if(!candidates.isEmpty())
+			text += QLatin1Char('\n') + tr("Did you mean %1 instead of %2?").arg(candidates.join(QStringLiteral(", ")), dashed(unknownName));
+	}
+	return text;
+}
+
+int QCliParser::childCount(const QCliNode *node)
+{
+	return static_cast<const QCliContext*>(node)->_nodes.size();
+}
+
+int QCliParser::childCount(const QCliStaticNode *node)
+{
+	return node->childCount;
+}
+
+QStringList QCliParser::childNames(const QCliNode *node)
+{
+	QStringList names;
+	const auto &nodes = static_cast<const QCliContext*>(node)->_nodes;
+	for(auto it = nodes.constBegin(); it != nodes.constEnd(); ++it) {
+		if(!it->second->isHidden())
+			names.append(it.key());
+	}
+	return names;
+}
+
+QStringList QCliParser::childNames(const QCliStaticNode *node)
+{
+	QStringList names;
+	for(auto i = 0; i < node->childCount; i++) {
+		if(!node->children[i].hidden)
+			names.append(QString::fromLatin1(node->children[i].name));
+	}
+	return names;
+}
+
+int QCliParser::registerFoundOption(ParseState &state, QStringView optionName, bool complete)
+{
+	auto &result = state.result;
+	const auto index = result.optionIndex(optionName);
+	if(index != -1) {
+		result._optionsFound.setBit(index);
+		if(complete)
+			result._optionNames.append(optionName.toString());
+	} else if(complete)
+		result._unknownOptionNames.append(optionName.toString());
+	return index;
+}
+
+bool QCliParser::parseOptionValue(ParseState &state, int optionIndex, const QCliArgument &argument, int &index, bool complete)
+{
+	if(optionIndex == -1)
+		return true;
+
+	auto &result = state.result;
+	const auto assignPos = argument.indexOf('=');
+	if(!result.optionAt(optionIndex).valueName().isEmpty()) {
+		if(assignPos == -1) {
+			const auto optionArgument = index;
+			index = state.nextIndex(index);
+			if(index >= state.arguments.size()) {
+				result._optionErrorText = QCommandLineParser::tr("Missing value after '%1'.").arg(state.arguments.toString(optionArgument));
+				return false;
+			}
+			if(complete)
+				result._optionValues[optionIndex].append(QCliParseResult::Token{index, 0});
+		} else if(complete)
+			result._optionValues[optionIndex].append(QCliParseResult::Token{index, assignPos + 1});
+	} else if(assignPos != -1) {
+		result._optionErrorText = QCommandLineParser::tr("Unexpected value after '%1'.").arg(argument.toString(0, assignPos));
+		return false;
+	}
+	return true;
+}
+
+QSharedPointer<const QCliDescriptionCatalog> QCliParser::loadDescriptionCatalog() const
+{
+	QMutexLocker locker{&_helpMutex};
+	if(!_catalogLoaded && !_descriptionCatalog.isEmpty()) {
+		_catalog = QCliDescriptionCatalog::load(_descriptionCatalog);
+		if(!_catalog)
+			qWarning().noquote() << "Unable to load description catalog" << _descriptionCatalog;
+		_catalogLoaded = true;
+	}
+	return _catalog;
+}
+
+void QCliParser::collectDescriptions(const QCliNode *node, const QStringList &path, QHash<QString, QString> &descriptions)
+{
+	for(const auto &option : node->_options) {
+		if(!option.description().isEmpty())
+			descriptions.insert(QCliDescriptionCatalog::optionKey(path, option.names().first()), option.description());
+	}
+
+	if(const auto context = dynamic_cast<const QCliContext*>(node)) {
+		context->createLazyNodes(); // the catalog is written at build time, so all nodes are needed
+		for(auto it = context->_nodes.constBegin(); it != context->_nodes.constEnd(); ++it) {
+			const auto childPath = path + QStringList{it.key()};
+			if(!it->first.isEmpty())
+				descriptions.insert(QCliDescriptionCatalog::key(childPath), it->first);
+			collectDescriptions(it->second.data(), childPath, descriptions);
+		}
+	} else if(const auto leaf = dynamic_cast<const QCliLeaf*>(node)) {
+		for(const auto &argument : leaf->_arguments) {
+			if(!std::get<1>(argument).isEmpty())
+				descriptions.insert(QCliDescriptionCatalog::positionalKey(path, std::get<0>(argument)), std::get<1>(argument));
+		}
+	}
+}
+
+void QCliParser::collectDescriptions(const QCliStaticNode *node, const QStringList &path, QHash<QString, QString> &descriptions)
+{
+	for(auto i = 0; i < node->optionCount; i++) {
+		const auto option = staticOption(node->options[i]);
+		if(!option.description().isEmpty())
+			descriptions.insert(QCliDescriptionCatalog::optionKey(path, option.names().first()), option.description());
+	}
+	for(auto i = 0; i < node->childCount; i++) {
+		const auto &child = node->children[i];
+		const auto childPath = path + QStringList{QString::fromLatin1(child.name)};
+		if(child.description && *child.description)
+			descriptions.insert(QCliDescriptionCatalog::key(childPath), QString::fromUtf8(child.description));
+		collectDescriptions(&child, childPath, descriptions);
+	}
+	for(auto i = 0; i < node->positionalCount; i++) {
+		const auto &positional = node->positionals[i];
+		if(positional.description && *positional.description) {
+			descriptions.insert(QCliDescriptionCatalog::positionalKey(path, QString::fromLatin1(positional.name)),
+								QString::fromUtf8(positional.description));
 		}
 	}
+}
+
+void QCliParser::prepareHelp(QCommandLineParser &helpParser) const
+{
+	// descriptions from the catalog take precedence over the ones stored in the tree
+	const auto catalog = loadDescriptionCatalog();
+	const auto &path = _result._contextChain;
+	const auto describe = [&](const QString &key, const QString &fallback) {
+		return catalog ? catalog->description(key, fallback) : fallback;
+	};
+
+	helpParser.setApplicationDescription(describe(QString{}, applicationDescription()));
+	for(const auto &option : _builtinOptions) {
+		if(option.names().contains(QStringLiteral("help")))
+			helpParser.addHelpOption();
+		else if(option.names().contains(QStringLiteral("version")))
+			helpParser.addVersionOption();
+		else if(!option.names().contains(QStringLiteral("help-all")))
+			helpParser.addOption(option);
+	}
+	for(auto i = _builtinOptions.size(); i < _result.optionCount(); i++) {
+		auto option = _result.optionAt(i);
+		if(catalog)
+			option.setDescription(catalog->optionDescription(path, option.names().first(), option.description()));
+		helpParser.addOption(option);
+	}
+
+	if(auto context = dynamic_cast<const QCliContext*>(_result._helpNode)) {
+		QList<QPair<QString, QString>> commands;
+		for(auto it = context->_nodes.constBegin(); it != context->_nodes.constEnd(); ++it) {
+			if(!it->second->isHidden())
+				commands.append(qMakePair(it.key(), describe(QCliDescriptionCatalog::key(path, it.key()), it->first)));
+		}
+		addContextHelp(helpParser, commands, context->_defaultNode);
+	} else if(auto leaf = dynamic_cast<const QCliLeaf*>(_result._helpNode)) {
+		auto arguments = leaf->_arguments;
+		for(auto &argument : arguments)
+			std::get<1>(argument) = describe(QCliDescriptionCatalog::positionalKey(path, std::get<0>(argument)), std::get<1>(argument));
+		addLeafHelp(helpParser, arguments);
+	} else if(_result._staticHelpNode && _result._staticHelpNode->type == QCliStaticNode::Context) {
+		QList<QPair<QString, QString>> commands;
+		for(auto i = 0; i < _result._staticHelpNode->childCount; i++) {
+			const auto &child = _result._staticHelpNode->children[i];
+			if(!child.hidden) {
+				const auto name = QString::fromLatin1(child.name);
+				commands.append(qMakePair(name, describe(QCliDescriptionCatalog::key(path, name), QString::fromUtf8(child.description))));
+			}
+		}
+		addContextHelp(helpParser, commands, QString::fromLatin1(_result._staticHelpNode->defaultNode));
+	} else if(_result._staticHelpNode) {
+		QList<std::tuple<QString, QString, QString>> arguments;
+		for(auto i = 0; i < _result._staticHelpNode->positionalCount; i++) {
+			const auto &positional = _result._staticHelpNode->positionals[i];
+			const auto name = QString::fromLatin1(positional.name);
+			arguments.append(std::make_tuple(name,
+											 describe(QCliDescriptionCatalog::positionalKey(path, name), QString::fromUtf8(positional.description)),
+											 positional.syntax ?
+												QString::fromLatin1(positional.syntax) :
+												QStringLiteral("<%1>").arg(name)));
+		}
+		addLeafHelp(helpParser, arguments);
+	}
+}
+
+void QCliParser::addContextHelp(QCommandLineParser &helpParser, const QList<QPair<QString, QString>> &commands, const QString &defaultNode) const
+{
+	//create positional args
+	QStringList printArgs;
+	printArgs.reserve(commands.size());
+	for(const auto &command : commands)
+		printArgs.append(command.first);
+
+	auto firstName = printArgs.first();
+	auto pFirstName = firstName;
+	if(firstName == defaultNode)
+		pFirstName = tr("%1 (default)").arg(firstName);
+	helpParser.addPositionalArgument(pFirstName,
+									 commands.first().second,
+									 (defaultNode.isNull() ? QStringLiteral("%1%2%3") : QStringLiteral("%1%2[%3]"))
+									 .arg(_result._contextChain.join(QLatin1Char(' ')),
+										  _result._contextChain.isEmpty() ? QString() : QStringLiteral(" "),
+										  printArgs.join(QLatin1Char('|'))));
+	for(auto i = 1; i < commands.size(); i++) {
+		auto name = commands[i].first;
+		auto pName = name;
+		if(name == defaultNode)
+			pName = tr("%1 (default)").arg(name);
+		helpParser.addPositionalArgument(pName, commands[i].second, QStringLiteral(" \b"));
+	}
+}
 
-	//parse completly now, must be valid!
-	if(!QCommandLineParser::parse(arguments))
-		throw QCommandLineParser::errorText();
+void QCliParser::addLeafHelp(QCommandLineParser &helpParser, const QList<std::tuple<QString, QString, QString>> &arguments) const
+{
+	if(arguments.isEmpty())
+		helpParser.addPositionalArgument(QStringLiteral(" "), QStringLiteral(" "), _result._contextChain.join(QLatin1Char(' ')));
+	else {
+		auto first = arguments.first();
+		helpParser.addPositionalArgument(std::get<0>(first),
+										 std::get<1>(first),
+										 QStringLiteral("%1 %2")
+										 .arg(_result._contextChain.join(QLatin1Char(' ')), std::get<2>(first)));
+		for(auto i = 1; i < arguments.size(); i++) {
+			const auto &pArg = arguments[i];
+			helpParser.addPositionalArgument(std::get<0>(pArg), std::get<1>(pArg), std::get<2>(pArg));
+		}
+	}
 }
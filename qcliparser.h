@@ -2,22 +2,118 @@
 #define QCLIPARSER_H
 
 #include "qclinode.h"
+#include "qclistaticschema.h"
+#include "qcliparseresult.h"
+#include "qclipositionalrange.h"
 
 #include <QtCore/QCommandLineParser>
+#include <QtCore/QMutex>
+#include <QtCore/QHash>
+#include <QtCore/QScopedPointer>
 
-class Q_CLI_PARSER_EXPORT QCliParser : public QCommandLineParser, public QCliContext
+class QCliFrozenTree;
+class QCliArgument;
+class QCliArgumentList;
+class QCliBkTree;
+class QCliNodeArena;
+class QCliDescriptionCatalog;
+class QCliSchemaImage;
+class QCliCompleter;
+
+// Parsing with parseArguments does not modify the parser. Once the tree is complete, a const
+// QCliParser can thus be shared between threads, with every thread getting its own QCliParseResult.
+// The QCommandLineParser base is private: it never sees the arguments, so it must not be used as one
+class Q_CLI_PARSER_EXPORT QCliParser : private QCommandLineParser, public QCliContext
 {
 	Q_DECLARE_TR_FUNCTIONS(QCliParser)
 
 public:
+	enum ResponseFileMode {
+		NoResponseFiles,
+		LineSeparatedResponseFiles,
+		NullSeparatedResponseFiles
+	};
+
 	QCliParser();
+	explicit QCliParser(const QCliStaticNode &staticSchema);
+	~QCliParser() override;
+
+	using QCommandLineParser::SingleDashWordOptionMode;
+	using QCommandLineParser::ParseAsCompactedShortOptions;
+	using QCommandLineParser::ParseAsLongOptions;
+	using QCommandLineParser::OptionsAfterPositionalArgumentsMode;
+	using QCommandLineParser::ParseAsOptions;
+	using QCommandLineParser::ParseAsPositionalArguments;
 
+	using QCommandLineParser::setApplicationDescription;
+	using QCommandLineParser::applicationDescription;
+	using QCommandLineParser::showVersion;
 	using QCliContext::addOption;
 	using QCliContext::addOptions;
 
+	void setSingleDashWordOptionMode(SingleDashWordOptionMode parsingMode);
+	void setOptionsAfterPositionalArgumentsMode(OptionsAfterPositionalArgumentsMode parsingMode);
+	void setResponseFileMode(ResponseFileMode mode);
+	ResponseFileMode responseFileMode() const;
+	void setNodeArenaEnabled(bool enabled);
+	bool isNodeArenaEnabled() const;
+
+	QCommandLineOption addVersionOption();
+	QCommandLineOption addHelpOption();
+	QCommandLineOption addBatchOption();
+	QCommandLineOption addCompletionOption();
+
 	void process(const QStringList &arguments, bool colored = false);
 	void process(const QCoreApplication &app, bool colored = false);
+	void process(int argc, const char *const *argv, bool colored = false);
+	// like process, but never exits. Returns false if the parser already handled the arguments completely
+	// (an error, help, version or completion output), with the exit code the process would have exited with
+	bool tryProcess(const QStringList &arguments, int &exitCode, bool colored = false);
 	bool parse(const QStringList &arguments);
+	bool parse(int argc, const char *const *argv);
+	void reset();
+
+	QCliParseResult parseArguments(const QStringList &arguments) const;
+	QCliParseResult parseArguments(int argc, const char *const *argv) const;
+	QCliParseResult parseResult() const;
+
+	// a static schema or a loaded schema image is flat already, so freeze is a no-op for them
+	void freeze();
+	bool isFrozen() const;
+	bool writeSchemaImage(const QString &fileName, quint32 revision = 0) const;
+	// replaces the tree. Option handles of nodes added before are not resolved anymore, use the option names instead
+	bool loadSchemaImage(const QString &fileName, quint32 revision = 0);
+
+	bool isSet(const QString &name) const;
+	QString value(const QString &name) const;
+	QStringList values(const QString &name) const;
+	bool isSet(const QCommandLineOption &option) const;
+	QString value(const QCommandLineOption &option) const;
+	QStringList values(const QCommandLineOption &option) const;
+	bool isSet(const QCliOptionHandle &option) const;
+	QString value(const QCliOptionHandle &option) const;
+	QStringList values(const QCliOptionHandle &option) const;
+	QVariant typedValue(const QString &name) const;
+	QVariantList typedValues(const QString &name) const;
+	QVariant typedValue(const QCliOptionHandle &option) const;
+	QVariantList typedValues(const QCliOptionHandle &option) const;
+	QVariant typedPositionalArgument(int index) const;
+
+	QStringList positionalArguments() const;
+	int positionalArgumentCount() const;
+	QString positionalArgument(int index) const;
+	// see QCliParseResult::positionalArgumentUtf8 - the data is not NUL-terminated
+	QByteArray positionalArgumentUtf8(int index) const;
+	QCliPositionalRange positionalRange(int first = 0) const;
+	QStringList optionNames() const;
+	QStringList unknownOptionNames() const;
+
+	Q_NORETURN void showHelp(int exitCode = 0);
+	QString helpText() const;
+
+	void setDescriptionCatalog(const QString &fileNamePattern);
+	QString descriptionCatalog() const;
+	bool writeDescriptionCatalog(const QString &fileName) const;
 
 	bool enterContext(const QString &name);
 	QString currentContext() const;
@@ -26,13 +122,63 @@ public:
 	QStringList contextChain() const;
 	QString errorText() const;
 
+	QStringList completions(const QStringList &words, int currentWord) const;
+	static QString completionScript(const QString &shell, const QString &programName = QString(), const QString &indexFile = QString());
+
+	void setCompletionIndexFile(const QString &fileName);
+	QString completionIndexFile() const;
+	bool writeCompletionIndex(const QString &fileName) const;
+
+	static QStringList splitCommandLine(const QString &commandLine, bool *ok = nullptr);
+
 private:
 	friend class QCliEvaluator;
+	friend class QCliGenerator;
+	friend class QCliDispatch;
+	struct ParseState;
+
+	SingleDashWordOptionMode _singleDashWordOptionMode;
+	OptionsAfterPositionalArgumentsMode _optionsAfterPositionalArgumentsMode;
+	ResponseFileMode _responseFileMode;
+	QList<QCommandLineOption> _builtinOptions;
+	QSharedPointer<const QCliFrozenTree> _frozenTree;
+	const QCliStaticNode *_staticSchema;
+	// mapped image that _staticSchema points into, if loaded with loadSchemaImage
+	QScopedPointer<QCliSchemaImage> _schemaImage;
+	bool _completionEnabled;
+	QString _completionIndexFile;
+	// owns all nodes of the tree if enabled. Destroyed before the root context (a base class)
+	QScopedPointer<QCliNodeArena> _nodeArena;
+
+	// result of the last parse call, for the QCommandLineParser like API
+	QCliParseResult _result;
 
-	QStringList _contextChain;
-	QString _errorText;
+	// "did you mean" indexes per node, for commands and options. Only built when a name was not found
+	struct SuggestionIndex {
+		int sourceSize = 0;
+		QSharedPointer<const QCliBkTree> tree;
+	};
+	mutable QMutex _suggestionMutex;
+	mutable QHash<QPair<const void*, bool>, SuggestionIndex> _suggestionIndexes;
 
-	int _readContextIndex;
+	// options of the static nodes, converted once when a node is entered for the first time
+	mutable QMutex _staticOptionMutex;
+	mutable QHash<const QCliStaticNode*, QList<QCommandLineOption>> _staticOptions;
+
+	// help texts per context chain (only once the tree cannot change anymore) and the lazily loaded catalog
+	struct HelpText {
+		QString applicationDescription;
+		QString text;
+	};
+	QString _descriptionCatalog;
+	mutable QMutex _helpMutex;
+	mutable bool _catalogLoaded;
+	mutable QSharedPointer<const QCliDescriptionCatalog> _catalog;
+	mutable QHash<QStringList, HelpText> _helpTexts;
+
+	// completer with the tries of all nodes entered so far. Only kept once the tree cannot change anymore
+	mutable QMutex _completerMutex;
+	mutable QScopedPointer<QCliCompleter> _completer;
 
 	static void showParserMessage(const QString &message);
 
@@ -40,8 +186,43 @@ private:
 	Q_NORETURN void addPositionalArgument(const QString &name, const QString &description, const QString &syntax = QString());
 	Q_NORETURN void clearPositionalArguments();
 
-	void parseContext(QCliContext *context, QStringList arguments);
-	void parseLeaf(QCliLeaf *leaf, const QStringList &arguments);
+	QCliParseResult parseArgumentList(const QSharedPointer<QCliArgumentList> &arguments) const;
+	bool processResult(const QString &program, bool colored, int &exitCode);
+	void resetCompleter();
+	template <typename TNode>
+	void parseNode(const TNode *node, ParseState &state) const;
+	void enterNode(const QCliNode *node, ParseState &state) const;
+	void enterNode(const QCliStaticNode *node, ParseState &state) const;
+	QList<QCommandLineOption> staticNodeOptions(const QCliStaticNode *node) const;
+	const QCliNode *findNode(const QCliNode *node, const QString &name, ParseState &state) const;
+	const QCliStaticNode *findNode(const QCliStaticNode *node, const QString &name, ParseState &state) const;
+	static QString defaultNodeName(const QCliNode *node);
+	static QString defaultNodeName(const QCliStaticNode *node);
+	void convertValues(const QCliNode *node, QCliParseResult &result) const;
+	void convertValues(const QCliStaticNode *node, QCliParseResult &result) const;
+
+	bool scanArguments(ParseState &state, bool complete) const;
+	static int registerFoundOption(ParseState &state, QStringView optionName, bool complete);
+	static bool parseOptionValue(ParseState &state, int optionIndex, const QCliArgument &argument, int &index, bool complete);
+	bool isBuiltinSet(const QString &name) const;
+
+	template <typename TNode>
+	QStringList commandSuggestions(const TNode *node, const QString &name) const;
+	QStringList optionSuggestions(const QCliParseResult &result, const QString &name) const;
+	template <typename TNames>
+	QStringList findSuggestions(const void *key, bool options, int sourceSize, const TNames &names, const QString &word) const;
+	QString unknownOptionText(const QCliParseResult &result) const;
+	static int childCount(const QCliNode *node);
+	static int childCount(const QCliStaticNode *node);
+	static QStringList childNames(const QCliNode *node);
+	static QStringList childNames(const QCliStaticNode *node);
+
+	QSharedPointer<const QCliDescriptionCatalog> loadDescriptionCatalog() const;
+	static void collectDescriptions(const QCliNode *node, const QStringList &path, QHash<QString, QString> &descriptions);
+	static void collectDescriptions(const QCliStaticNode *node, const QStringList &path, QHash<QString, QString> &descriptions);
+	void prepareHelp(QCommandLineParser &helpParser) const;
+	void addContextHelp(QCommandLineParser &helpParser, const QList<QPair<QString, QString>> &commands, const QString &defaultNode) const;
+	void addLeafHelp(QCommandLineParser &helpParser, const QList<std::tuple<QString, QString, QString>> &arguments) const;
 };
 
 #endif // QCLIPARSER_H
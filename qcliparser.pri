@@ -1,17 +1,45 @@
 HEADERS += \
 	$$PWD/qclievaluator.h \
+	$$PWD/qcliserver.h \
+	$$PWD/qcliserverprotocol.h \
+	$$PWD/qclidispatch.h \
 	$$PWD/qcligenerator.h \
 	$$PWD/qcligenerator_meta.h \
+	$$PWD/qcligenerator_p.h \
 	$$PWD/qcliparser.h \
-	$$PWD/qclinode.h
+	$$PWD/qcliparseresult.h \
+	$$PWD/qclipositionalrange.h \
+	$$PWD/qclinode.h \
+	$$PWD/qclivaluetype.h \
+	$$PWD/qclistaticschema.h \
+	$$PWD/qclifrozentree_p.h \
+	$$PWD/qclicompleter_p.h \
+	$$PWD/qclicompletionindex.h \
+	$$PWD/qcliargumentlist_p.h \
+	$$PWD/qclibktree_p.h \
+	$$PWD/qclinodearena_p.h \
+	$$PWD/qclidescriptioncatalog_p.h \
+	$$PWD/qclischemaimage_p.h
 
 SOURCES += \
 	$$PWD/qclievaluator.cpp \
+	$$PWD/qcliserver.cpp \
+	$$PWD/qclidispatch.cpp \
 	$$PWD/qcligenerator.cpp \
 	$$PWD/qcliparser.cpp \
-	$$PWD/qclinode.cpp
+	$$PWD/qcliparseresult.cpp \
+	$$PWD/qclipositionalrange.cpp \
+	$$PWD/qclinode.cpp \
+	$$PWD/qclivaluetype.cpp \
+	$$PWD/qclifrozentree.cpp \
+	$$PWD/qclicompleter.cpp \
+	$$PWD/qcliargumentlist.cpp \
+	$$PWD/qclibktree.cpp \
+	$$PWD/qclinodearena.cpp \
+	$$PWD/qclidescriptioncatalog.cpp \
+	$$PWD/qclischemaimage.cpp
 
-win32: LIBS += -luser32
+win32: LIBS += -luser32 -lshell32
 
 INCLUDEPATH += $$PWD
 
@@ -19,3 +47,23 @@ QDEP_DEPENDS += Skycoder42/QGenericTree
 
 QDEP_PACKAGE_EXPORTS += Q_CLI_PARSER_EXPORT
 !qdep_build: DEFINES += "Q_CLI_PARSER_EXPORT="
+
+# generates static dispatch tables for the evaluators in QCLI_DISPATCH_HEADERS, see qclidispatch.h
+# the tool is searched in the Qt installation (see tools/dispatchgen), then in PATH
+isEmpty(QCLI_DISPATCHGEN) {
+	win32: QCLI_DISPATCHGEN_INSTALLED = $$[QT_INSTALL_BINS]/qcli-dispatchgen.exe
+	else: QCLI_DISPATCHGEN_INSTALLED = $$[QT_INSTALL_BINS]/qcli-dispatchgen
+	exists($$QCLI_DISPATCHGEN_INSTALLED): QCLI_DISPATCHGEN = $$QCLI_DISPATCHGEN_INSTALLED
+}
+isEmpty(QCLI_DISPATCHGEN) {
+	QCLI_DISPATCHGEN = qcli-dispatchgen
+} else {
+	# only a path can be a make dependency
+	qcli_dispatch.depends = $$QCLI_DISPATCHGEN
+}
+qcli_dispatch.name = qcli-dispatchgen ${QMAKE_FILE_IN}
+qcli_dispatch.input = QCLI_DISPATCH_HEADERS
+qcli_dispatch.output = ${QMAKE_VAR_OBJECTS_DIR}qclidispatch_${QMAKE_FILE_BASE}.cpp
+qcli_dispatch.commands = $$shell_path($$QCLI_DISPATCHGEN) -o ${QMAKE_FILE_OUT} ${QMAKE_FILE_IN}
+qcli_dispatch.variable_out = GENERATED_SOURCES
+QMAKE_EXTRA_COMPILERS += qcli_dispatch
@@ -0,0 +1,406 @@
+#include "qcliparseresult.h"
+#include "qclifrozentree_p.h"
+#include "qcliargumentlist_p.h"
+#include "qclipositionalrange.h"
+#include <QtCore/QCommandLineParser>
+
+QCliParseResult::QCliParseResult() :
+	_valid(false),
+	_contextChain(),
+	_errorText(),
+	_readContextIndex(-1),
+	_frozenTree(),
+	_frozenNode(-1),
+	_optionList(),
+	_nameHash(),
+	_nodeOptions(),
+	_arguments(),
+	_builtinOptionCount(0),
+	_optionsFound(),
+	_optionValues(),
+	_optionNames(),
+	_unknownOptionNames(),
+	_positionalArguments(),
+	_optionErrorText(),
+	_typedOptionValues(),
+	_typedPositionalArguments(),
+	_helpNode(nullptr),
+	_staticHelpNode(nullptr)
+{}
+
+bool QCliParseResult::isValid() const
+{
+	return _valid;
+}
+
+QString QCliParseResult::errorText() const
+{
+	return _errorText;
+}
+
+bool QCliParseResult::isSet(const QString &name) const
+{
+	const auto index = optionIndex(name);
+	if(index == -1) {
+		qWarning("QCommandLineParser: option not defined: \"%ls\"", qUtf16Printable(name));
+		return false;
+	}
+	return isSetAt(index);
+}
+
+QString QCliParseResult::value(const QString &name) const
+{
+	const auto valueList = values(name);
+	if(valueList.isEmpty())
+		return {};
+	else
+		return valueList.last();
+}
+
+QStringList QCliParseResult::values(const QString &name) const
+{
+	const auto index = optionIndex(name);
+	if(index != -1)
+		return valuesAt(index);
+
+	qWarning("QCommandLineParser: option not defined: \"%ls\"", qUtf16Printable(name));
+	return {};
+}
+
+bool QCliParseResult::isSet(const QCommandLineOption &option) const
+{
+	return isSet(option.names().first());
+}
+
+QString QCliParseResult::value(const QCommandLineOption &option) const
+{
+	return value(option.names().first());
+}
+
+QStringList QCliParseResult::values(const QCommandLineOption &option) const
+{
+	return values(option.names().first());
+}
+
+bool QCliParseResult::isSet(const QCliOptionHandle &option) const
+{
+	const auto index = optionIndex(option);
+	if(index == -1) {
+		qWarning("QCliParseResult: option handle does not belong to the context chain");
+		return false;
+	}
+	return isSetAt(index);
+}
+
+QString QCliParseResult::value(const QCliOptionHandle &option) const
+{
+	const auto valueList = values(option);
+	if(valueList.isEmpty())
+		return {};
+	else
+		return valueList.last();
+}
+
+QStringList QCliParseResult::values(const QCliOptionHandle &option) const
+{
+	const auto index = optionIndex(option);
+	if(index != -1)
+		return valuesAt(index);
+
+	qWarning("QCliParseResult: option handle does not belong to the context chain");
+	return {};
+}
+
+QVariant QCliParseResult::typedValue(const QString &name) const
+{
+	const auto valueList = typedValues(name);
+	if(valueList.isEmpty())
+		return {};
+	else
+		return valueList.last();
+}
+
+QVariantList QCliParseResult::typedValues(const QString &name) const
+{
+	const auto index = optionIndex(name);
+	if(index != -1)
+		return typedValuesAt(index);
+
+	qWarning("QCommandLineParser: option not defined: \"%ls\"", qUtf16Printable(name));
+	return {};
+}
+
+QVariant QCliParseResult::typedValue(const QCliOptionHandle &option) const
+{
+	const auto valueList = typedValues(option);
+	if(valueList.isEmpty())
+		return {};
+	else
+		return valueList.last();
+}
+
+QVariantList QCliParseResult::typedValues(const QCliOptionHandle &option) const
+{
+	const auto index = optionIndex(option);
+	if(index != -1)
+		return typedValuesAt(index);
+
+	qWarning("QCliParseResult: option handle does not belong to the context chain");
+	return {};
+}
+
+QVariant QCliParseResult::typedPositionalArgument(int index) const
+{
+	if(_typedPositionalArguments.isEmpty())
+		return positionalArgument(index);
+	else
+		return _typedPositionalArguments.value(index);
+}
+
+QStringList QCliParseResult::positionalArguments() const
+{
+	QStringList arguments;
+	arguments.reserve(_positionalArguments.size());
+	for(const auto &token : _positionalArguments)
+		arguments.append(tokenString(token));
+	return arguments;
+}
+
+int QCliParseResult::positionalArgumentCount() const
+{
+	return _positionalArguments.size();
+}
+
+QString QCliParseResult::positionalArgument(int index) const
+{
+	return tokenString(_positionalArguments.value(index, Token{-1, 0}));
+}
+
+QByteArray QCliParseResult::positionalArgumentUtf8(int index) const
+{
+	// no copy for arguments from argv
+	const auto token = _positionalArguments.value(index, Token{-1, 0});
+	if(token.argument == -1)
+		return {};
+	return _arguments->toUtf8(token.argument, token.offset);
+}
+
+QCliPositionalRange QCliParseResult::positionalRange(int first) const
+{
+	return QCliPositionalRange{*this, first};
+}
+
+QStringList QCliParseResult::optionNames() const
+{
+	return _optionNames;
+}
+
+QStringList QCliParseResult::unknownOptionNames() const
+{
+	return _unknownOptionNames;
+}
+
+bool QCliParseResult::enterContext(const QString &name)
+{
+	auto nIndex = _readContextIndex + 1;
+	if(nIndex < 0 ||
+	   nIndex >= _contextChain.size())
+		return false;
+
+	if(_contextChain[nIndex] == name) {
+		_readContextIndex++;
+		return true;
+	} else
+		return false;
+}
+
+QString QCliParseResult::currentContext() const
+{
+	if(_readContextIndex < 0 ||
+	   _readContextIndex >= _contextChain.size())
+		return {};
+	else
+		return _contextChain[_readContextIndex];
+}
+
+bool QCliParseResult::leaveContext()
+{
+	if(_readContextIndex >= 0) {
+		_readContextIndex--;
+		return true;
+	} else
+		return false;
+}
+
+QStringList QCliParseResult::contextChain() const
+{
+	return _contextChain;
+}
+
+void QCliParseResult::registerOptions(const QList<QCommandLineOption> &options, QVector<int> *indexes)
+{
+	// same semantics as QCommandLineParser::addOptions: options with already known names are skipped
+	const auto firstIndex = _optionList.size();
+	for(auto i = 0; i < options.size(); i++) {
+		const auto names = options[i].names();
+		auto knownIndex = -1;
+		for(const auto &name : names) {
+			knownIndex = _nameHash.value(name, -1);
+			if(knownIndex != -1)
+				break;
+		}
+		if(knownIndex != -1) {
+			// indexes are only needed once the options stop being contiguous
+			if(indexes && indexes->isEmpty()) {
+				indexes->reserve(options.size());
+				for(auto j = 0; j < i; j++)
+					indexes->append(firstIndex + j);
+			}
+			if(indexes)
+				indexes->append(knownIndex);
+			continue;
+		}
+
+		_optionList.append(options[i]);
+		for(const auto &name : names)
+			_nameHash.insert(name, _optionList.size() - 1);
+		if(indexes && !indexes->isEmpty())
+			indexes->append(_optionList.size() - 1);
+	}
+}
+
+void QCliParseResult::registerNodeOptions(const QCliNode *node)
+{
+	if(_frozenNode != -1)
+		_nodeOptions.append(NodeOptions{node, _frozenNode, 0, {}});
+	else {
+		NodeOptions entry{node, -1, _optionList.size(), {}};
+		registerOptions(node->_options, &entry.indexes);
+		_nodeOptions.append(entry);
+	}
+}
+
+int QCliParseResult::optionIndex(QStringView name) const
+{
+	if(_frozenNode != -1)
+		return _frozenTree->findOption(_frozenNode, name);
+	else
+		return _nameHash.value(name.toString(), -1);
+}
+
+int QCliParseResult::optionIndex(const QCliOptionHandle &option) const
+{
+	return optionIndex(option._node, option._index);
+}
+
+int QCliParseResult::optionIndex(const QCliNode *node, int localIndex) const
+{
+	// the chain is only as long as the number of entered contexts, and only pointers are compared
+	for(const auto &entry : _nodeOptions) {
+		if(entry.node != node)
+			continue;
+		if(entry.frozenNode != -1)
+			return _frozenTree->localOption(entry.frozenNode, localIndex);
+		else if(!entry.indexes.isEmpty())
+			return entry.indexes[localIndex];
+		else
+			return entry.firstIndex + localIndex;
+	}
+	return -1;
+}
+
+int QCliParseResult::optionCount() const
+{
+	if(_frozenNode != -1)
+		return _frozenTree->optionCount(_frozenNode);
+	else
+		return _optionList.size();
+}
+
+const QCommandLineOption &QCliParseResult::optionAt(int index) const
+{
+	if(_frozenNode != -1)
+		return _frozenTree->option(_frozenNode, index);
+	else
+		return _optionList[index];
+}
+
+bool QCliParseResult::isSetAt(int index) const
+{
+	return index < _optionsFound.size() && _optionsFound.testBit(index);
+}
+
+QStringList QCliParseResult::valuesAt(int index) const
+{
+	const auto tokens = _optionValues.value(index);
+	if(tokens.isEmpty())
+		return optionAt(index).defaultValues();
+	QStringList valueList;
+	valueList.reserve(tokens.size());
+	for(const auto &token : tokens)
+		valueList.append(tokenString(token));
+	return valueList;
+}
+
+QVariantList QCliParseResult::typedValuesAt(int index) const
+{
+	const auto it = _typedOptionValues.constFind(index);
+	if(it != _typedOptionValues.constEnd())
+		return *it;
+	QVariantList valueList;
+	for(const auto &value : valuesAt(index))
+		valueList.append(value);
+	return valueList;
+}
+
+bool QCliParseResult::isTypedAt(int index) const
+{
+	return _typedOptionValues.contains(index);
+}
+
+QStringList QCliParseResult::typedStringsAt(int index) const
+{
+	QStringList strings;
+	for(const auto &value : typedValuesAt(index)) {
+		if(value.userType() == QMetaType::QStringList)
+			strings.append(value.toStringList());
+		else
+			strings.append(value.toString());
+	}
+	return strings;
+}
+
+bool QCliParseResult::flagAt(int index) const
+{
+	const auto it = _typedOptionValues.constFind(index);
+	if(it == _typedOptionValues.constEnd() || it->isEmpty())
+		return true;
+	else
+		return it->last().toBool();
+}
+
+bool QCliParseResult::isBuiltinSet(const QString &name) const
+{
+	// like isSet, but without a warning if the builtin option was never added. Options of the tree
+	// with the same name as a builtin one that was never added are no builtin options
+	const auto index = optionIndex(name);
+	return index != -1 && index < _builtinOptionCount && isSetAt(index);
+}
+
+QString QCliParseResult::optionErrorText() const
+{
+	if(!_optionErrorText.isEmpty())
+		return _optionErrorText;
+	if(_unknownOptionNames.size() == 1)
+		return QCommandLineParser::tr("Unknown option '%1'.").arg(_unknownOptionNames.first());
+	if(_unknownOptionNames.size() > 1)
+		return QCommandLineParser::tr("Unknown options: %1.").arg(_unknownOptionNames.join(QStringLiteral(", ")));
+	return {};
+}
+
+QString QCliParseResult::tokenString(const Token &token) const
+{
+	if(token.argument == -1)
+		return {};
+	return _arguments->toString(token.argument, token.offset);
+}
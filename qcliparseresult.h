@@ -0,0 +1,131 @@
+#ifndef QCLIPARSERESULT_H
+#define QCLIPARSERESULT_H
+
+#include "qclinode.h"
+#include "qclistaticschema.h"
+
+#include <QtCore/QCommandLineOption>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QBitArray>
+#include <QtCore/QVector>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QMetaType>
+#include <QtCore/QVariant>
+
+class QCliFrozenTree;
+class QCliArgumentList;
+class QCliPositionalRange;
+
+// The outcome of a single QCliParser::parseArguments call. It owns everything that was found while
+// parsing, so it can be copied around and used independently of the parser and of other results.
+// Values are only converted to strings when read. For results of QCliParser::parseArguments(argc, argv)
+// they are read from argv, so argv must outlive them
+class Q_CLI_PARSER_EXPORT QCliParseResult
+{
+public:
+	QCliParseResult();
+
+	bool isValid() const;
+	QString errorText() const;
+
+	bool isSet(const QString &name) const;
+	QString value(const QString &name) const;
+	QStringList values(const QString &name) const;
+	bool isSet(const QCommandLineOption &option) const;
+	QString value(const QCommandLineOption &option) const;
+	QStringList values(const QCommandLineOption &option) const;
+	// resolved without hashing or comparing names. Invalid for options of nodes outside of the context chain
+	bool isSet(const QCliOptionHandle &option) const;
+	QString value(const QCliOptionHandle &option) const;
+	QStringList values(const QCliOptionHandle &option) const;
+	// values converted while parsing for options and arguments declared with a QCliValueType. Plain strings otherwise
+	QVariant typedValue(const QString &name) const;
+	QVariantList typedValues(const QString &name) const;
+	QVariant typedValue(const QCliOptionHandle &option) const;
+	QVariantList typedValues(const QCliOptionHandle &option) const;
+	QVariant typedPositionalArgument(int index) const;
+
+	QStringList positionalArguments() const;
+	int positionalArgumentCount() const;
+	QString positionalArgument(int index) const;
+	// UTF-8 data without a copy where possible. Like QByteArray::fromRawData, it is not NUL-terminated
+	QByteArray positionalArgumentUtf8(int index) const;
+	QCliPositionalRange positionalRange(int first = 0) const;
+	QStringList optionNames() const;
+	QStringList unknownOptionNames() const;
+
+	bool enterContext(const QString &name);
+	QString currentContext() const;
+	bool leaveContext();
+
+	QStringList contextChain() const;
+
+private:
+	friend class QCliParser;
+	friend class QCliEvaluator;
+	friend class QCliDispatch;
+
+	// position of a value within the parsed arguments. Converted to a string only when read
+	struct Token {
+		int argument;
+		int offset;
+	};
+
+	// where the options of an entered node ended up in the option registry
+	struct NodeOptions {
+		const QCliNode *node;
+		int frozenNode; // resolved via the frozen tree if set
+		int firstIndex;
+		QVector<int> indexes; // only used if some options were skipped as duplicates
+	};
+
+	bool _valid;
+	QStringList _contextChain;
+	QString _errorText;
+
+	int _readContextIndex;
+
+	// option registry of the current node. Either a node of the frozen tree, or a list of its own
+	QSharedPointer<const QCliFrozenTree> _frozenTree;
+	int _frozenNode;
+	QList<QCommandLineOption> _optionList;
+	QHash<QString, int> _nameHash;
+	QVector<NodeOptions> _nodeOptions;
+
+	QSharedPointer<const QCliArgumentList> _arguments;
+	int _builtinOptionCount; // the builtin options of the parser are always the first ones in the registry
+	QBitArray _optionsFound;
+	QHash<int, QVector<Token>> _optionValues;
+	QStringList _optionNames;
+	QStringList _unknownOptionNames;
+	QVector<Token> _positionalArguments;
+	QString _optionErrorText;
+	QHash<int, QVariantList> _typedOptionValues;
+	QVariantList _typedPositionalArguments; // empty if the leaf has no typed arguments
+	const QCliNode *_helpNode;
+	const QCliStaticNode *_staticHelpNode;
+
+	void registerOptions(const QList<QCommandLineOption> &options, QVector<int> *indexes = nullptr);
+	void registerNodeOptions(const QCliNode *node);
+	int optionIndex(QStringView name) const;
+	int optionIndex(const QCliOptionHandle &option) const;
+	int optionIndex(const QCliNode *node, int localIndex) const;
+	int optionCount() const;
+	const QCommandLineOption &optionAt(int index) const;
+	bool isSetAt(int index) const;
+	QStringList valuesAt(int index) const;
+	QVariantList typedValuesAt(int index) const;
+	bool isTypedAt(int index) const;
+	// the typed values as strings, with enum sets merged into one list
+	QStringList typedStringsAt(int index) const;
+	// the value of an option written to a bool: true for options without a value type, otherwise the converted value
+	bool flagAt(int index) const;
+	bool isBuiltinSet(const QString &name) const;
+	QString optionErrorText() const;
+	QString tokenString(const Token &token) const;
+};
+
+Q_DECLARE_METATYPE(QCliParseResult)
+
+#endif // QCLIPARSERESULT_H
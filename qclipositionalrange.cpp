@@ -0,0 +1,96 @@
+#include "qclipositionalrange.h"
+#include <algorithm>
+
+QCliPositionalRange::const_iterator::const_iterator() :
+	_range(nullptr),
+	_index(0)
+{}
+
+QCliPositionalRange::const_iterator::const_iterator(const QCliPositionalRange *range, int index) :
+	_range(range),
+	_index(index)
+{}
+
+QString QCliPositionalRange::const_iterator::operator*() const
+{
+	return _range->at(_index);
+}
+
+QByteArray QCliPositionalRange::const_iterator::utf8() const
+{
+	return _range->utf8At(_index);
+}
+
+QCliPositionalRange::const_iterator &QCliPositionalRange::const_iterator::operator++()
+{
+	++_index;
+	return *this;
+}
+
+QCliPositionalRange::const_iterator QCliPositionalRange::const_iterator::operator++(int)
+{
+	auto old = *this;
+	++_index;
+	return old;
+}
+
+bool QCliPositionalRange::const_iterator::operator==(const const_iterator &other) const
+{
+	return _range == other._range && _index == other._index;
+}
+
+bool QCliPositionalRange::const_iterator::operator!=(const const_iterator &other) const
+{
+	return !(*this == other);
+}
+
+
+
+QCliPositionalRange::QCliPositionalRange() :
+	_result(),
+	_first(0)
+{}
+
+QCliPositionalRange::QCliPositionalRange(const QCliParseResult &result, int first) :
+	_result(result), // implicitly shared, the arguments themselves are never copied
+	_first(std::min(std::max(first, 0), result.positionalArgumentCount()))
+{}
+
+int QCliPositionalRange::size() const
+{
+	return _result.positionalArgumentCount() - _first;
+}
+
+bool QCliPositionalRange::isEmpty() const
+{
+	return size() == 0;
+}
+
+QString QCliPositionalRange::at(int index) const
+{
+	return _result.positionalArgument(_first + index);
+}
+
+QByteArray QCliPositionalRange::utf8At(int index) const
+{
+	return _result.positionalArgumentUtf8(_first + index);
+}
+
+QCliPositionalRange::const_iterator QCliPositionalRange::begin() const
+{
+	return const_iterator{this, 0};
+}
+
+QCliPositionalRange::const_iterator QCliPositionalRange::end() const
+{
+	return const_iterator{this, size()};
+}
+
+QStringList QCliPositionalRange::toStringList() const
+{
+	QStringList list;
+	list.reserve(size());
+	for(const auto &argument : *this)
+		list.append(argument);
+	return list;
+}
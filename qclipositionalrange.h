@@ -0,0 +1,65 @@
+#ifndef QCLIPOSITIONALRANGE_H
+#define QCLIPOSITIONALRANGE_H
+
+#include "qcliparseresult.h"
+
+#include <QtCore/QMetaType>
+#include <iterator>
+
+// The positional arguments of a parse result, starting at a given index. Nothing is copied or
+// converted up front: every argument is converted when it is accessed, straight from the parsed
+// arguments (and thus from argv or a response file). Evaluator methods can take a range as their
+// last parameter to receive all additional positional arguments that way
+class Q_CLI_PARSER_EXPORT QCliPositionalRange
+{
+public:
+	class Q_CLI_PARSER_EXPORT const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = QString;
+		using difference_type = int;
+		using pointer = void;
+		using reference = QString;
+
+		const_iterator();
+
+		QString operator*() const;
+		QByteArray utf8() const;
+		const_iterator &operator++();
+		const_iterator operator++(int);
+		bool operator==(const const_iterator &other) const;
+		bool operator!=(const const_iterator &other) const;
+
+	private:
+		friend class QCliPositionalRange;
+
+		const QCliPositionalRange *_range;
+		int _index;
+
+		const_iterator(const QCliPositionalRange *range, int index);
+	};
+	using iterator = const_iterator;
+
+	QCliPositionalRange();
+	explicit QCliPositionalRange(const QCliParseResult &result, int first = 0);
+
+	int size() const;
+	bool isEmpty() const;
+	QString at(int index) const;
+	// not NUL-terminated, see QCliParseResult::positionalArgumentUtf8
+	QByteArray utf8At(int index) const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	QStringList toStringList() const;
+
+private:
+	QCliParseResult _result;
+	int _first;
+};
+
+Q_DECLARE_METATYPE(QCliPositionalRange)
+
+#endif // QCLIPOSITIONALRANGE_H
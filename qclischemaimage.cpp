@@ -0,0 +1,292 @@
+#include "qclischemaimage_p.h"
+#include <QtCore/QHash>
+#include <QtCore/QCoreApplication>
+#include <cstring>
+
+namespace {
+
+constexpr char ImageMagic[8] = "QCLISCH";
+
+class ImageStrings
+{
+public:
+	ImageStrings() :
+		_data(1, '\0'),
+		_offsets()
+	{}
+
+	quint32 add(const QByteArray &string) {
+		if(string.isEmpty())
+			return 0;
+		auto it = _offsets.constFind(string);
+		if(it == _offsets.constEnd()) {
+			it = _offsets.insert(string, static_cast<quint32>(_data.size()));
+			_data.append(string);
+			_data.append('\0');
+		}
+		return *it;
+	}
+
+	quint32 addOptional(const QByteArray &string, quint32 none) {
+		return string.isEmpty() ? none : add(string);
+	}
+
+	const QByteArray &data() const {
+		return _data;
+	}
+
+private:
+	QByteArray _data;
+	QHash<QByteArray, quint32> _offsets;
+};
+
+bool isLatin1(const QString &string)
+{
+	for(const auto c : string) {
+		if(c.unicode() > 0xFF)
+			return false;
+	}
+	return true;
+}
+
+template <typename T>
+void appendRaw(QByteArray &target, const T *data, int count)
+{
+	target.append(reinterpret_cast<const char*>(data), count * static_cast<int>(sizeof(T)));
+}
+
+}
+
+QCliSchemaImage::QCliSchemaImage() :
+	_file(),
+	_nodes(),
+	_options(),
+	_positionals()
+{}
+
+QByteArray QCliSchemaImage::create(const QCliContext *root, quint32 revision, QString *errorString)
+{
+	struct Entry {
+		const QCliNode *node;
+		QString name;
+		QString description;
+	};
+
+	// names are read as latin1 by the static schema, just like names of compile time schemas
+	const auto latin1 = [&](const QString &string, const QString &context) {
+		if(isLatin1(string))
+			return true;
+		*errorString = QCoreApplication::translate("QCliParser", "Name \"%1\" of %2 is not latin1").arg(string, context);
+		return false;
+	};
+
+	ImageStrings strings;
+	QVector<Node> nodes;
+	QVector<Option> options;
+	QVector<Positional> positionals;
+	QVector<Entry> queue {Entry{root, {}, {}}};
+	for(auto i = 0; i < queue.size(); i++) {
+		const auto entry = queue[i];
+		const auto path = QStringLiteral("node \"%1\"").arg(entry.name);
+
+		Node node;
+		node.type = QCliStaticNode::Leaf;
+		node.name = strings.add(entry.name.toLatin1());
+		node.description = strings.add(entry.description.toUtf8());
+		node.firstChild = 0;
+		node.childCount = 0;
+		node.defaultNode = None;
+		node.flags = entry.node->isHidden() ? Hidden : 0u;
+
+		node.firstOption = static_cast<quint32>(options.size());
+		node.optionCount = static_cast<quint32>(entry.node->_options.size());
+		for(const auto &option : entry.node->_options) {
+			const auto names = option.names().join(QLatin1Char('|'));
+			if(!latin1(names, path) || !latin1(option.valueName(), path))
+				return {};
+			if(option.defaultValues().size() > 1) {
+				*errorString = QCoreApplication::translate("QCliParser", "Option \"%1\" has more than one default value").arg(names);
+				return {};
+			}
+			options.append(Option {
+				strings.add(names.toLatin1()),
+				strings.add(option.description().toUtf8()),
+				strings.addOptional(option.valueName().toLatin1(), None),
+				strings.addOptional(option.defaultValues().value(0).toUtf8(), None),
+				option.flags().testFlag(QCommandLineOption::HiddenFromHelp) ? Hidden : 0u
+			});
+		}
+
+		node.firstPositional = static_cast<quint32>(positionals.size());
+		node.positionalCount = 0;
+		if(const auto context = dynamic_cast<const QCliContext*>(entry.node)) {
+			// lazy contexts are resolved once, so that they are part of the image
+			context->createLazyNodes();
+			node.type = QCliStaticNode::Context;
+			node.firstChild = static_cast<quint32>(queue.size());
+			node.childCount = static_cast<quint32>(context->_nodes.size());
+			if(!context->_defaultNode.isNull()) {
+				if(!latin1(context->_defaultNode, path))
+					return {};
+				node.defaultNode = strings.add(context->_defaultNode.toLatin1());
+			}
+			for(auto it = context->_nodes.constBegin(); it != context->_nodes.constEnd(); ++it) {
+				if(!latin1(it.key(), path))
+					return {};
+				queue.append(Entry{it->second.data(), it.key(), it->first});
+			}
+		} else if(const auto leaf = dynamic_cast<const QCliLeaf*>(entry.node)) {
+			node.positionalCount = static_cast<quint32>(leaf->_arguments.size());
+			for(const auto &argument : leaf->_arguments) {
+				if(!latin1(std::get<0>(argument), path) || !latin1(std::get<2>(argument), path))
+					return {};
+				positionals.append(Positional {
+					strings.add(std::get<0>(argument).toLatin1()),
+					strings.add(std::get<1>(argument).toUtf8()),
+					strings.addOptional(std::get<2>(argument).toLatin1(), None)
+				});
+			}
+		}
+		nodes.append(node);
+	}
+
+	Header header;
+	std::memcpy(header.magic, ImageMagic, sizeof(header.magic));
+	header.version = Version;
+	header.revision = revision;
+	header.nodeCount = static_cast<quint32>(nodes.size());
+	header.nodeOffset = sizeof(Header);
+	header.optionCount = static_cast<quint32>(options.size());
+	header.optionOffset = header.nodeOffset + header.nodeCount * sizeof(Node);
+	header.positionalCount = static_cast<quint32>(positionals.size());
+	header.positionalOffset = header.optionOffset + header.optionCount * sizeof(Option);
+	header.stringSize = static_cast<quint32>(strings.data().size());
+	header.stringOffset = header.positionalOffset + header.positionalCount * sizeof(Positional);
+
+	QByteArray image;
+	image.reserve(static_cast<int>(header.stringOffset + header.stringSize));
+	appendRaw(image, &header, 1);
+	appendRaw(image, nodes.constData(), nodes.size());
+	appendRaw(image, options.constData(), options.size());
+	appendRaw(image, positionals.constData(), positionals.size());
+	image.append(strings.data());
+	return image;
+}
+
+bool QCliSchemaImage::load(const QString &fileName, quint32 revision, QString *errorString)
+{
+	const auto fail = [&](const QString &error) {
+		*errorString = error;
+		_nodes.clear();
+		_options.clear();
+		_positionals.clear();
+		_file.close(); // also unmaps the file
+		return false;
+	};
+
+	_file.setFileName(fileName);
+	if(!_file.open(QIODevice::ReadOnly))
+		return fail(_file.errorString());
+	const auto size = _file.size();
+	const auto data = _file.map(0, size);
+	if(!data)
+		return fail(_file.errorString());
+
+	const auto header = table<Header>(data, size, 0, 1);
+	if(!header || std::memcmp(header->magic, ImageMagic, sizeof(header->magic)) != 0)
+		return fail(QCoreApplication::translate("QCliParser", "Not a schema image"));
+	if(header->version != Version || header->revision != revision)
+		return fail(QCoreApplication::translate("QCliParser", "Schema image is outdated"));
+
+	const auto nodes = table<Node>(data, size, header->nodeOffset, header->nodeCount);
+	const auto options = table<Option>(data, size, header->optionOffset, header->optionCount);
+	const auto positionals = table<Positional>(data, size, header->positionalOffset, header->positionalCount);
+	const auto strings = table<char>(data, size, header->stringOffset, header->stringSize);
+	if(!nodes || header->nodeCount == 0 ||
+	   (!options && header->optionCount > 0) ||
+	   (!positionals && header->positionalCount > 0) ||
+	   !strings || header->stringSize == 0 || strings[header->stringSize - 1] != '\0')
+		return fail(QCoreApplication::translate("QCliParser", "Schema image is corrupted"));
+
+	// only the descriptors are created. Strings stay in the mapping
+	auto valid = true;
+	const auto string = [&](quint32 offset) -> const char * {
+		if(offset == None)
+			return nullptr;
+		if(offset >= header->stringSize) {
+			valid = false;
+			return nullptr;
+		}
+		return strings + offset;
+	};
+	// names are dereferenced by the parser, so they must exist
+	const auto requiredString = [&](quint32 offset) -> const char * {
+		const auto result = string(offset);
+		if(!result)
+			valid = false;
+		return result;
+	};
+	const auto inRange = [](quint32 first, quint32 count, quint32 total) {
+		return first <= total && count <= total - first;
+	};
+
+	_options.resize(static_cast<int>(header->optionCount));
+	for(quint32 i = 0; i < header->optionCount; i++) {
+		auto &option = _options[static_cast<int>(i)];
+		option.names = requiredString(options[i].names);
+		option.description = string(options[i].description);
+		option.valueName = string(options[i].valueName);
+		option.defaultValue = string(options[i].defaultValue);
+		option.hidden = options[i].flags & Hidden;
+	}
+	_positionals.resize(static_cast<int>(header->positionalCount));
+	for(quint32 i = 0; i < header->positionalCount; i++) {
+		auto &positional = _positionals[static_cast<int>(i)];
+		positional.name = requiredString(positionals[i].name);
+		positional.description = string(positionals[i].description);
+		positional.syntax = string(positionals[i].syntax);
+	}
+	_nodes.resize(static_cast<int>(header->nodeCount));
+	for(quint32 i = 0; i < header->nodeCount; i++) {
+		const auto &source = nodes[i];
+		// children always come after their parent, so the tree cannot contain cycles
+		if(source.type > static_cast<quint32>(QCliStaticNode::Leaf) ||
+		   !inRange(source.firstChild, source.childCount, header->nodeCount) ||
+		   (source.childCount > 0 && source.firstChild <= i) ||
+		   !inRange(source.firstOption, source.optionCount, header->optionCount) ||
+		   !inRange(source.firstPositional, source.positionalCount, header->positionalCount))
+			return fail(QCoreApplication::translate("QCliParser", "Schema image is corrupted"));
+
+		auto &node = _nodes[static_cast<int>(i)];
+		node.type = static_cast<QCliStaticNode::Type>(source.type);
+		node.name = requiredString(source.name);
+		node.description = string(source.description);
+		node.children = source.childCount > 0 ? _nodes.constData() + source.firstChild : nullptr;
+		node.childCount = static_cast<int>(source.childCount);
+		node.options = source.optionCount > 0 ? _options.constData() + source.firstOption : nullptr;
+		node.optionCount = static_cast<int>(source.optionCount);
+		node.positionals = source.positionalCount > 0 ? _positionals.constData() + source.firstPositional : nullptr;
+		node.positionalCount = static_cast<int>(source.positionalCount);
+		node.defaultNode = string(source.defaultNode);
+		node.hidden = source.flags & Hidden;
+	}
+
+	if(!valid || _nodes[0].type != QCliStaticNode::Context || !QCliStatic::isValid(_nodes[0]))
+		return fail(QCoreApplication::translate("QCliParser", "Schema image is corrupted"));
+	return true;
+}
+
+const QCliStaticNode *QCliSchemaImage::root() const
+{
+	return _nodes.isEmpty() ? nullptr : _nodes.constData();
+}
+
+template <typename T>
+const T *QCliSchemaImage::table(const uchar *data, qint64 size, quint32 offset, quint32 count)
+{
+	if(count == 0 ||
+	   offset % alignof(T) != 0 ||
+	   static_cast<qint64>(offset) + static_cast<qint64>(count) * static_cast<qint64>(sizeof(T)) > size)
+		return nullptr;
+	return reinterpret_cast<const T*>(data + offset);
+}
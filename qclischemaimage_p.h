@@ -0,0 +1,84 @@
+#ifndef QCLISCHEMAIMAGE_P_H
+#define QCLISCHEMAIMAGE_P_H
+
+#include "qclinode.h"
+#include "qclistaticschema.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QVector>
+
+// Binary image of a complete QCliParser tree. All strings are stored in a single table and the
+// nodes breadth first, so the children of every node are contiguous. Loading maps the file and
+// only creates the static schema descriptors, whose strings point directly into the mapping. The
+// parser then treats the image like a compile time schema (see qclistaticschema.h)
+class QCliSchemaImage
+{
+	Q_DISABLE_COPY(QCliSchemaImage)
+
+public:
+	QCliSchemaImage();
+
+	static QByteArray create(const QCliContext *root, quint32 revision, QString *errorString);
+
+	bool load(const QString &fileName, quint32 revision, QString *errorString);
+	const QCliStaticNode *root() const;
+
+private:
+	static constexpr quint32 Version = 1;
+	static constexpr quint32 None = 0xFFFFFFFFu;
+
+	static constexpr quint32 Hidden = 0x01;
+
+	// all values in host byte order, strings are offsets into the string table
+	struct Header {
+		char magic[8];
+		quint32 version;
+		quint32 revision;
+		quint32 nodeCount;
+		quint32 nodeOffset;
+		quint32 optionCount;
+		quint32 optionOffset;
+		quint32 positionalCount;
+		quint32 positionalOffset;
+		quint32 stringSize;
+		quint32 stringOffset;
+	};
+
+	struct Node {
+		quint32 type;
+		quint32 name;
+		quint32 description;
+		quint32 firstChild;
+		quint32 childCount;
+		quint32 firstOption;
+		quint32 optionCount;
+		quint32 firstPositional;
+		quint32 positionalCount;
+		quint32 defaultNode;
+		quint32 flags;
+	};
+
+	struct Option {
+		quint32 names; // separated by '|'
+		quint32 description;
+		quint32 valueName;
+		quint32 defaultValue;
+		quint32 flags;
+	};
+
+	struct Positional {
+		quint32 name;
+		quint32 description;
+		quint32 syntax;
+	};
+
+	QFile _file;
+	QVector<QCliStaticNode> _nodes;
+	QVector<QCliStaticOption> _options;
+	QVector<QCliStaticPositional> _positionals;
+
+	template <typename T>
+	static const T *table(const uchar *data, qint64 size, quint32 offset, quint32 count);
+};
+
+#endif // QCLISCHEMAIMAGE_P_H
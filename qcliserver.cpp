@@ -0,0 +1,387 @@
+#include "qcliserver.h"
+#include "qcliserverprotocol.h"
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/time.h>
+#  include <sys/un.h>
+#  if defined(__GLIBC__) || defined(Q_OS_ANDROID)
+#    include <stdio_ext.h>
+#  endif
+extern char **environ;
+#endif
+
+namespace {
+
+#ifdef QT_NO_DEBUG
+constexpr auto LogScope = QtWarningMsg;
+#else
+constexpr auto LogScope = QtDebugMsg;
+#endif
+
+// a client that does not send its request in time is dropped, as it would block all other clients
+constexpr int RequestTimeout = 5;
+
+Q_LOGGING_CATEGORY(cliServer, "QCliServer", LogScope)
+
+#ifdef Q_OS_UNIX
+bool readAll(int fd, char *data, size_t size)
+{
+	while(size > 0) {
+		const auto count = ::read(fd, data, size);
+		if(count == -1 && errno == EINTR)
+			continue;
+		if(count <= 0)
+			return false;
+		data += count;
+		size -= static_cast<size_t>(count);
+	}
+	return true;
+}
+
+bool writeAll(int fd, const char *data, size_t size)
+{
+	while(size > 0) {
+		const auto count = ::write(fd, data, size);
+		if(count == -1 && errno == EINTR)
+			continue;
+		if(count <= 0)
+			return false;
+		data += count;
+		size -= static_cast<size_t>(count);
+	}
+	return true;
+}
+
+// clearerr alone keeps input that was buffered, but not read yet, for the next user of stdin
+void purgeStdin()
+{
+#if defined(__GLIBC__) || defined(Q_OS_ANDROID)
+	__fpurge(stdin);
+#elif defined(Q_OS_DARWIN) || defined(Q_OS_FREEBSD) || defined(Q_OS_NETBSD) || defined(Q_OS_OPENBSD)
+	fpurge(stdin);
+#else
+	fflush(stdin);
+#endif
+	clearerr(stdin);
+}
+
+QByteArrayList currentEnvironment()
+{
+	QByteArrayList environment;
+	for(auto entry = environ; entry && *entry; ++entry)
+		environment.append(QByteArray{*entry});
+	return environment;
+}
+
+void setEnvironment(const QByteArrayList &environment)
+{
+	for(const auto &entry : currentEnvironment())
+		qunsetenv(entry.left(entry.indexOf('=')).constData());
+	for(const auto &entry : environment) {
+		const auto assignPos = entry.indexOf('=');
+		if(assignPos > 0)
+			qputenv(entry.left(assignPos).constData(), entry.mid(assignPos + 1));
+	}
+}
+#endif
+
+}
+
+struct QCliServer::Request
+{
+	int fds[3] = {-1, -1, -1};
+	QString workingDirectory;
+	QStringList arguments;
+	QByteArrayList environment;
+
+	~Request();
+};
+
+QCliServer::Request::~Request()
+{
+#ifdef Q_OS_UNIX
+	for(const auto fd : fds) {
+		if(fd != -1)
+			::close(fd);
+	}
+#endif
+}
+
+
+
+QCliServer::QCliServer(QCliParser *parser, QCliEvaluator *evaluator, QObject *parent) :
+	QObject{parent},
+	_parser(parser),
+	_evaluator(evaluator),
+	_socketPath(),
+	_errorString(),
+	_socket(-1),
+	_notifier(nullptr)
+{}
+
+QCliServer::~QCliServer()
+{
+	close();
+}
+
+QString QCliServer::socketPath() const
+{
+	return _socketPath;
+}
+
+bool QCliServer::isListening() const
+{
+	return _socket != -1;
+}
+
+QString QCliServer::errorString() const
+{
+	return _errorString;
+}
+
+bool QCliServer::listen(const QString &socketPath)
+{
+	close();
+#ifdef Q_OS_UNIX
+	const auto path = QFile::encodeName(socketPath);
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(static_cast<size_t>(path.size()) >= sizeof(address.sun_path)) {
+		_errorString = tr("The socket path \"%1\" is too long").arg(socketPath);
+		return false;
+	}
+	std::memcpy(address.sun_path, path.constData(), static_cast<size_t>(path.size()));
+
+	_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(_socket == -1) {
+		_errorString = QString::fromLocal8Bit(std::strerror(errno));
+		return false;
+	}
+	::fcntl(_socket, F_SETFD, FD_CLOEXEC);
+
+	// only replace the socket file if no other server answers on it
+	if(::connect(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+		_errorString = tr("Another server is already listening on \"%1\"").arg(socketPath);
+		::close(_socket);
+		_socket = -1;
+		return false;
+	}
+	::close(_socket);
+	_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(_socket == -1) {
+		_errorString = QString::fromLocal8Bit(std::strerror(errno));
+		return false;
+	}
+	::fcntl(_socket, F_SETFD, FD_CLOEXEC);
+	::unlink(path.constData());
+
+	// clients run commands as the user of the server -> nobody else may connect
+	const auto oldMask = ::umask(0077);
+	const auto bound = ::bind(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+	::umask(oldMask);
+	if(!bound || ::listen(_socket, SOMAXCONN) == -1) {
+		_errorString = QString::fromLocal8Bit(std::strerror(errno));
+		::close(_socket);
+		_socket = -1;
+		return false;
+	}
+
+	_socketPath = socketPath;
+	_notifier = new QSocketNotifier{_socket, QSocketNotifier::Read, this};
+	connect(_notifier, &QSocketNotifier::activated,
+			this, &QCliServer::acceptConnection);
+	return true;
+#else
+	Q_UNUSED(socketPath)
+	_errorString = tr("QCliServer is only supported on Unix systems");
+	return false;
+#endif
+}
+
+void QCliServer::close()
+{
+#ifdef Q_OS_UNIX
+	if(_socket == -1)
+		return;
+	// might be called by a command, while the notifier is still delivering its signal
+	_notifier->setEnabled(false);
+	_notifier->deleteLater();
+	_notifier = nullptr;
+	::close(_socket);
+	_socket = -1;
+	::unlink(QFile::encodeName(_socketPath).constData());
+	_socketPath.clear();
+#endif
+}
+
+int QCliServer::exec(const QStringList &arguments)
+{
+	// same as QCliParser::process and QCliEvaluator::exec, but without ever exiting the process
+	auto exitCode = EXIT_FAILURE;
+	if(!_parser->tryProcess(arguments, exitCode))
+		return exitCode;
+	if(_parser->isBuiltinSet(QStringLiteral("batch")))
+		return _evaluator->execBatch(*_parser);
+	else
+		return _evaluator->exec(*_parser);
+}
+
+void QCliServer::acceptConnection()
+{
+#ifdef Q_OS_UNIX
+	const auto connection = ::accept(_socket, nullptr, nullptr);
+	if(connection == -1)
+		return;
+	::fcntl(connection, F_SETFD, FD_CLOEXEC);
+	timeval timeout {RequestTimeout, 0};
+	::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	// commands can run event loops, e.g. while waiting for asynchronous evaluators. No other request
+	// may start during that time, as it would take over the same stdio, working directory and environment
+	const auto notifier = _notifier;
+	notifier->setEnabled(false);
+	Request request;
+	if(readRequest(connection, request)) {
+		const QCliServerResponse response {execRequest(request)};
+		if(!writeAll(connection, reinterpret_cast<const char*>(&response), sizeof(response)))
+			qCWarning(cliServer) << "Failed to send the exit code to the client";
+	}
+	::close(connection);
+	if(_notifier == notifier) // not closed by the command
+		notifier->setEnabled(true);
+#endif
+}
+
+bool QCliServer::readRequest(int connection, Request &request) const
+{
+#ifdef Q_OS_UNIX
+	// the stdio descriptors are attached to the first bytes of the header
+	QCliServerRequest header;
+	iovec vector {&header, sizeof(header)};
+	union {
+		cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(request.fds))];
+	} control;
+	std::memset(&control, 0, sizeof(control));
+	msghdr message;
+	std::memset(&message, 0, sizeof(message));
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+
+	ssize_t count;
+	do
+		count = ::recvmsg(connection, &message, 0);
+	while(count == -1 && errno == EINTR);
+	if(count <= 0) {
+		qCWarning(cliServer) << "Failed to read request:" << std::strerror(errno);
+		return false;
+	}
+	for(auto cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+		if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		const auto fdCount = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		std::memcpy(request.fds, CMSG_DATA(cmsg), std::min(fdCount, sizeof(request.fds) / sizeof(int)) * sizeof(int));
+		// more than expected -> close the rest right away
+		for(auto i = sizeof(request.fds) / sizeof(int); i < fdCount; ++i) {
+			int fd;
+			std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+			::close(fd);
+		}
+	}
+	for(const auto fd : request.fds) {
+		if(fd == -1) {
+			qCWarning(cliServer) << "Request without stdio descriptors";
+			return false;
+		}
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	if(!readAll(connection, reinterpret_cast<char*>(&header) + count, sizeof(header) - static_cast<size_t>(count)) ||
+	   std::memcmp(header.magic, QCLI_SERVER_MAGIC, sizeof(QCLI_SERVER_MAGIC)) != 0 ||
+	   header.version != QCLI_SERVER_VERSION ||
+	   header.size == 0 ||
+	   header.size > QCLI_SERVER_MAX_REQUEST_SIZE) {
+		qCWarning(cliServer) << "Invalid request header";
+		return false;
+	}
+
+	QByteArray payload{static_cast<int>(header.size), Qt::Uninitialized};
+	if(!readAll(connection, payload.data(), header.size) || !payload.endsWith('\0')) {
+		qCWarning(cliServer) << "Incomplete request";
+		return false;
+	}
+	payload.chop(1);
+	const auto strings = payload.split('\0');
+	if(static_cast<quint64>(strings.size()) != 1ull + header.argCount + header.envCount || header.argCount == 0) {
+		qCWarning(cliServer) << "Invalid request data";
+		return false;
+	}
+
+	request.workingDirectory = QFile::decodeName(strings[0]);
+	request.arguments.reserve(static_cast<int>(header.argCount));
+	for(auto i = 0u; i < header.argCount; ++i)
+		request.arguments.append(QString::fromUtf8(strings[static_cast<int>(1 + i)]));
+	request.environment = strings.mid(static_cast<int>(1 + header.argCount));
+	return true;
+#else
+	Q_UNUSED(connection)
+	Q_UNUSED(request)
+	return false;
+#endif
+}
+
+int QCliServer::execRequest(const Request &request)
+{
+#ifdef Q_OS_UNIX
+	// take over the stdio, working directory and environment of the client for the time of the command
+	fflush(stdout);
+	fflush(stderr);
+	int savedFds[3];
+	for(auto i = 0; i < 3; ++i) {
+		savedFds[i] = ::dup(i);
+		::dup2(request.fds[i], i);
+	}
+	purgeStdin();
+	const auto savedDirectory = QDir::currentPath();
+	const auto savedEnvironment = currentEnvironment();
+	setEnvironment(request.environment);
+
+	auto exitCode = EXIT_FAILURE;
+	if(QDir::setCurrent(request.workingDirectory))
+		exitCode = exec(request.arguments);
+	else {
+		QCliParser::showParserMessage(tr("Failed to change into the working directory \"%1\"\n")
+									  .arg(request.workingDirectory));
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	setEnvironment(savedEnvironment);
+	QDir::setCurrent(savedDirectory);
+	for(auto i = 0; i < 3; ++i) {
+		::dup2(savedFds[i], i);
+		::close(savedFds[i]);
+	}
+	purgeStdin();
+
+	emit requestFinished(request.arguments, exitCode);
+	return exitCode;
+#else
+	Q_UNUSED(request)
+	return EXIT_FAILURE;
+#endif
+}
@@ -0,0 +1,55 @@
+#ifndef QCLISERVER_H
+#define QCLISERVER_H
+
+#include "qcliparser.h"
+#include "qclievaluator.h"
+
+#include <QtCore/QObject>
+
+class QSocketNotifier;
+
+// Keeps a process with a complete parser tree and evaluator running, and executes the commands that
+// client stubs (see tools/client and qcliserverprotocol.h) forward via a Unix domain socket. Every command
+// runs with the arguments, working directory, environment and stdio of its client. As these are
+// process wide, commands are executed one after another. Only available on Unix systems
+class Q_CLI_PARSER_EXPORT QCliServer : public QObject
+{
+	Q_OBJECT
+
+	Q_PROPERTY(QString socketPath READ socketPath)
+	Q_PROPERTY(bool listening READ isListening)
+
+public:
+	QCliServer(QCliParser *parser, QCliEvaluator *evaluator, QObject *parent = nullptr);
+	~QCliServer() override;
+
+	QString socketPath() const;
+	bool isListening() const;
+	QString errorString() const;
+
+	// the socket file is only accessible to the current user. A stale file of a server that is gone is replaced
+	bool listen(const QString &socketPath);
+	void close();
+
+	// runs a command like a client request does, but with the stdio and environment of this process
+	int exec(const QStringList &arguments);
+
+signals:
+	void requestFinished(const QStringList &arguments, int exitCode);
+
+private:
+	struct Request;
+
+	QCliParser *_parser;
+	QCliEvaluator *_evaluator;
+	QString _socketPath;
+	QString _errorString;
+	int _socket;
+	QSocketNotifier *_notifier;
+
+	void acceptConnection();
+	bool readRequest(int connection, Request &request) const;
+	int execRequest(const Request &request);
+};
+
+#endif // QCLISERVER_H
@@ -0,0 +1,31 @@
+#ifndef QCLISERVERPROTOCOL_H
+#define QCLISERVERPROTOCOL_H
+
+#include <stdint.h>
+
+/* Protocol between QCliServer and its client stubs. Plain C, so that clients can use it without Qt.
+ * A client connects to the Unix domain socket of the server and sends a single request: a
+ * QCliServerRequest header, with the client's stdin, stdout and stderr attached as SCM_RIGHTS
+ * ancillary data to the first bytes of the header. It is followed by `size` bytes of NUL-terminated
+ * UTF-8 strings: the working directory, then `argCount` arguments (starting with the program name)
+ * and then `envCount` environment entries of the form KEY=VALUE. Once the command finished, the
+ * server answers with a QCliServerResponse and closes the connection. All integers are in host byte
+ * order. */
+
+#define QCLI_SERVER_MAGIC "QCLISRV"
+#define QCLI_SERVER_VERSION 1u
+#define QCLI_SERVER_MAX_REQUEST_SIZE (16u * 1024u * 1024u)
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t argCount;
+	uint32_t envCount;
+	uint32_t size;
+} QCliServerRequest;
+
+typedef struct {
+	int32_t exitCode;
+} QCliServerResponse;
+
+#endif /* QCLISERVERPROTOCOL_H */
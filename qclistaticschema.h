@@ -0,0 +1,145 @@
+#ifndef QCLISTATICSCHEMA_H
+#define QCLISTATICSCHEMA_H
+
+#include <QtCore/qglobal.h>
+
+// A CLI tree that is defined at compile time. All strings must be latin1 literals, option names are
+// separated by a '|' (e.g. "s|size"). The children of a context must be sorted by name, which can
+// be verified with a static_assert on QCliStatic::isValid(root)
+
+struct QCliStaticOption
+{
+	const char *names;
+	const char *description;
+	const char *valueName = nullptr;
+	const char *defaultValue = nullptr;
+	bool hidden = false;
+};
+
+struct QCliStaticPositional
+{
+	const char *name;
+	const char *description;
+	const char *syntax = nullptr;
+};
+
+struct QCliStaticNode
+{
+	enum Type {
+		Context,
+		Leaf
+	};
+
+	Type type;
+	const char *name;
+	const char *description;
+	const QCliStaticNode *children = nullptr;
+	int childCount = 0;
+	const QCliStaticOption *options = nullptr;
+	int optionCount = 0;
+	const QCliStaticPositional *positionals = nullptr;
+	int positionalCount = 0;
+	const char *defaultNode = nullptr;
+	bool hidden = false;
+};
+
+namespace QCliStatic {
+
+constexpr int compare(const char *lhs, const char *rhs)
+{
+	while(*lhs && *lhs == *rhs) {
+		++lhs;
+		++rhs;
+	}
+	return static_cast<unsigned char>(*lhs) - static_cast<unsigned char>(*rhs);
+}
+
+template <int NChildren>
+constexpr QCliStaticNode context(const char *name, const char *description,
+								 const QCliStaticNode (&children)[NChildren])
+{
+	return {QCliStaticNode::Context, name, description, children, NChildren};
+}
+
+template <int NChildren, int NOptions>
+constexpr QCliStaticNode context(const char *name, const char *description,
+								 const QCliStaticNode (&children)[NChildren],
+								 const QCliStaticOption (&options)[NOptions])
+{
+	return {QCliStaticNode::Context, name, description, children, NChildren, options, NOptions};
+}
+
+constexpr QCliStaticNode leaf(const char *name, const char *description)
+{
+	return {QCliStaticNode::Leaf, name, description};
+}
+
+template <int NOptions>
+constexpr QCliStaticNode leaf(const char *name, const char *description,
+							  const QCliStaticOption (&options)[NOptions])
+{
+	return {QCliStaticNode::Leaf, name, description, nullptr, 0, options, NOptions};
+}
+
+template <int NPositionals>
+constexpr QCliStaticNode leaf(const char *name, const char *description,
+							  const QCliStaticPositional (&positionals)[NPositionals])
+{
+	return {QCliStaticNode::Leaf, name, description, nullptr, 0, nullptr, 0, positionals, NPositionals};
+}
+
+template <int NPositionals, int NOptions>
+constexpr QCliStaticNode leaf(const char *name, const char *description,
+							  const QCliStaticPositional (&positionals)[NPositionals],
+							  const QCliStaticOption (&options)[NOptions])
+{
+	return {QCliStaticNode::Leaf, name, description, nullptr, 0, options, NOptions, positionals, NPositionals};
+}
+
+template <int NChildren>
+constexpr QCliStaticNode root(const QCliStaticNode (&children)[NChildren])
+{
+	return context("", "", children);
+}
+
+template <int NChildren, int NOptions>
+constexpr QCliStaticNode root(const QCliStaticNode (&children)[NChildren],
+							  const QCliStaticOption (&options)[NOptions])
+{
+	return context("", "", children, options);
+}
+
+constexpr QCliStaticNode withDefault(QCliStaticNode node, const char *defaultNode)
+{
+	node.defaultNode = defaultNode;
+	return node;
+}
+
+constexpr QCliStaticNode hidden(QCliStaticNode node)
+{
+	node.hidden = true;
+	return node;
+}
+
+constexpr bool isValid(const QCliStaticNode &node)
+{
+	if(node.type == QCliStaticNode::Leaf)
+		return node.childCount == 0;
+	if(node.childCount == 0)
+		return false;
+
+	auto hasDefault = !node.defaultNode;
+	for(auto i = 0; i < node.childCount; ++i) {
+		if(i > 0 && compare(node.children[i - 1].name, node.children[i].name) >= 0)
+			return false;
+		if(node.defaultNode && compare(node.defaultNode, node.children[i].name) == 0)
+			hasDefault = true;
+		if(!isValid(node.children[i]))
+			return false;
+	}
+	return hasDefault;
+}
+
+}
+
+#endif // QCLISTATICSCHEMA_H
@@ -0,0 +1,183 @@
+#include "qclivaluetype.h"
+#include <QtCore/QDir>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+struct Unit {
+	const char *suffix;
+	qint64 factor;
+};
+
+constexpr Unit DurationUnits[] = {
+	{"", 1000},
+	{"ms", 1},
+	{"s", 1000},
+	{"sec", 1000},
+	{"m", 60 * 1000},
+	{"min", 60 * 1000},
+	{"h", 60 * 60 * 1000},
+	{"d", 24 * 60 * 60 * 1000}
+};
+
+constexpr Unit SizeUnits[] = {
+	{"", 1},
+	{"b", 1},
+	{"k", Q_INT64_C(1) << 10},
+	{"kb", Q_INT64_C(1) << 10},
+	{"kib", Q_INT64_C(1) << 10},
+	{"m", Q_INT64_C(1) << 20},
+	{"mb", Q_INT64_C(1) << 20},
+	{"mib", Q_INT64_C(1) << 20},
+	{"g", Q_INT64_C(1) << 30},
+	{"gb", Q_INT64_C(1) << 30},
+	{"gib", Q_INT64_C(1) << 30},
+	{"t", Q_INT64_C(1) << 40},
+	{"tb", Q_INT64_C(1) << 40},
+	{"tib", Q_INT64_C(1) << 40}
+};
+
+// <number><unit>, e.g. 1.5h or 512M. The number may be fractional, the result is rounded
+template <size_t N>
+bool convertWithUnit(const QString &text, const Unit (&units)[N], QVariant &value)
+{
+	auto unitPos = text.size();
+	while(unitPos > 0 && text[unitPos - 1].isLetter())
+		--unitPos;
+	const auto suffix = text.midRef(unitPos).toString().toLower();
+	auto ok = false;
+	const auto number = text.leftRef(unitPos).trimmed().toDouble(&ok);
+	if(!ok || !std::isfinite(number) || number < 0)
+		return false;
+
+	for(const auto &unit : units) {
+		if(suffix != QLatin1String{unit.suffix})
+			continue;
+		const auto result = number * static_cast<double>(unit.factor);
+		if(result >= static_cast<double>(std::numeric_limits<qint64>::max()))
+			return false;
+		value = static_cast<qint64>(std::llround(result));
+		return true;
+	}
+	return false;
+}
+
+}
+
+QCliValueType::QCliValueType(Type type) :
+	_type(type),
+	_enumValues()
+{}
+
+QCliValueType::QCliValueType(const QStringList &enumValues) :
+	QCliValueType{Enum, enumValues}
+{}
+
+QCliValueType::QCliValueType(Type type, const QStringList &enumValues) :
+	_type(type),
+	_enumValues(enumValues)
+{
+	Q_ASSERT_X(type == Enum || type == EnumSet, Q_FUNC_INFO, "Only enums and enum sets have names");
+}
+
+QCliValueType::Type QCliValueType::type() const
+{
+	return _type;
+}
+
+QStringList QCliValueType::enumValues() const
+{
+	return _enumValues;
+}
+
+bool QCliValueType::convert(const QString &text, QVariant &value) const
+{
+	auto ok = false;
+	switch(_type) {
+	case String:
+		value = text;
+		return true;
+	case Int: {
+		const auto number = text.toInt(&ok);
+		if(ok)
+			value = number;
+		return ok;
+	}
+	case Double: {
+		const auto number = text.toDouble(&ok);
+		if(ok)
+			value = number;
+		return ok;
+	}
+	case Bool: {
+		const auto lower = text.toLower();
+		if(lower == QStringLiteral("true") || lower == QStringLiteral("yes") ||
+		   lower == QStringLiteral("on") || lower == QStringLiteral("1"))
+			value = true;
+		else if(lower == QStringLiteral("false") || lower == QStringLiteral("no") ||
+				lower == QStringLiteral("off") || lower == QStringLiteral("0"))
+			value = false;
+		else
+			return false;
+		return true;
+	}
+	case Enum:
+		if(!_enumValues.contains(text))
+			return false;
+		value = text;
+		return true;
+	case EnumSet: {
+		QStringList names;
+		// split without SkipEmptyParts, which is deprecated since Qt 5.15
+		for(const auto &part : text.split(QLatin1Char(','))) {
+			const auto name = part.trimmed();
+			if(name.isEmpty())
+				continue;
+			if(!_enumValues.contains(name))
+				return false;
+			if(!names.contains(name))
+				names.append(name);
+		}
+		value = names;
+		return true;
+	}
+	case Duration:
+		return convertWithUnit(text, DurationUnits, value);
+	case Size:
+		return convertWithUnit(text, SizeUnits, value);
+	case Path:
+		if(text.isEmpty())
+			return false;
+		value = QDir::cleanPath(QDir::fromNativeSeparators(text));
+		return true;
+	}
+	Q_UNREACHABLE();
+	return false;
+}
+
+QString QCliValueType::description() const
+{
+	switch(_type) {
+	case String:
+		return tr("a string");
+	case Int:
+		return tr("an integer");
+	case Double:
+		return tr("a number");
+	case Bool:
+		return tr("true or false");
+	case Enum:
+		return tr("one of: %1").arg(_enumValues.join(QStringLiteral(", ")));
+	case EnumSet:
+		return tr("a comma separated list of: %1").arg(_enumValues.join(QStringLiteral(", ")));
+	case Duration:
+		return tr("a duration like 500ms, 30s, 5m or 2h");
+	case Size:
+		return tr("a size like 512, 4K or 1G");
+	case Path:
+		return tr("a path");
+	}
+	Q_UNREACHABLE();
+	return {};
+}
@@ -0,0 +1,53 @@
+#ifndef QCLIVALUETYPE_H
+#define QCLIVALUETYPE_H
+
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+#include <QtCore/QCoreApplication>
+
+// Declared type of an option value or a positional argument. Typed values are validated and converted
+// once while parsing, so bad input is rejected before anything is executed. Durations are converted to
+// milliseconds and sizes to bytes, both as qint64. Plain numbers are seconds and bytes respectively. An
+// enum is one of the given names, an enum set a comma separated list of them, converted to a QStringList
+class Q_CLI_PARSER_EXPORT QCliValueType
+{
+	Q_DECLARE_TR_FUNCTIONS(QCliValueType)
+
+public:
+	enum Type {
+		String,
+		Int,
+		Double,
+		Bool,
+		Enum,
+		EnumSet,
+		Duration,
+		Size,
+		Path
+	};
+
+	QCliValueType(Type type = String);
+	QCliValueType(const QStringList &enumValues);
+	QCliValueType(Type type, const QStringList &enumValues);
+
+	Type type() const;
+	QStringList enumValues() const;
+
+	bool convert(const QString &text, QVariant &value) const;
+	QString description() const;
+
+private:
+	Type _type;
+	QStringList _enumValues;
+};
+
+// a type together with how often an option can be given, or how many arguments a positional argument
+// takes. A maxCount of -1 means no limit
+struct QCliValueSpec
+{
+	QCliValueType type;
+	int minCount;
+	int maxCount;
+};
+
+#endif // QCLIVALUETYPE_H
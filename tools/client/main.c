@@ -0,0 +1,173 @@
+#include <qcliserverprotocol.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Client stub for QCliServer. Called as: qcli-client <socket> <program> [arguments...]
+// Forwards the arguments, working directory, environment and stdio to the server and exits with the
+// exit code of the command. If no server is listening, it runs <program> directly instead
+
+#define EXIT_NOT_FOUND 127
+
+extern char **environ;
+
+typedef struct {
+	char *data;
+	size_t size;
+	size_t capacity;
+} Buffer;
+
+static int appendString(Buffer *buffer, const char *string)
+{
+	const size_t length = strlen(string) + 1;
+	if(buffer->size + length > buffer->capacity) {
+		size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+		while(buffer->size + length > capacity)
+			capacity *= 2;
+		char *data = realloc(buffer->data, capacity);
+		if(!data)
+			return 0;
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->data + buffer->size, string, length);
+	buffer->size += length;
+	return 1;
+}
+
+static int connectServer(const char *socketPath)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(strlen(socketPath) >= sizeof(address.sun_path))
+		return -1;
+	strcpy(address.sun_path, socketPath);
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1)
+		return -1;
+	if(connect(fd, (const struct sockaddr*)&address, sizeof(address)) == -1) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int writeAll(int fd, const char *data, size_t size)
+{
+	while(size > 0) {
+		const ssize_t count = write(fd, data, size);
+		if(count == -1 && errno == EINTR)
+			continue;
+		if(count <= 0)
+			return 0;
+		data += count;
+		size -= (size_t)count;
+	}
+	return 1;
+}
+
+static int readAll(int fd, char *data, size_t size)
+{
+	while(size > 0) {
+		const ssize_t count = read(fd, data, size);
+		if(count == -1 && errno == EINTR)
+			continue;
+		if(count <= 0)
+			return 0;
+		data += count;
+		size -= (size_t)count;
+	}
+	return 1;
+}
+
+static int sendHeader(int fd, const QCliServerRequest *header)
+{
+	const int stdioFds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+	union {
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(stdioFds))];
+	} control;
+	memset(&control, 0, sizeof(control));
+
+	struct iovec vector;
+	vector.iov_base = (void*)header;
+	vector.iov_len = sizeof(*header);
+	struct msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(stdioFds));
+	memcpy(CMSG_DATA(cmsg), stdioFds, sizeof(stdioFds));
+
+	ssize_t count;
+	do
+		count = sendmsg(fd, &message, 0);
+	while(count == -1 && errno == EINTR);
+	if(count <= 0)
+		return 0;
+	// the descriptors were sent with the first bytes
+	return writeAll(fd, (const char*)header + count, sizeof(*header) - (size_t)count);
+}
+
+static void runDirectly(char **argv)
+{
+	execvp(argv[0], argv);
+	fprintf(stderr, "qcli-client: failed to run %s: %s\n", argv[0], strerror(errno));
+	exit(EXIT_NOT_FOUND);
+}
+
+int main(int argc, char **argv)
+{
+	if(argc < 3) {
+		fputs("Usage: qcli-client <socket> <program> [arguments...]\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	const int fd = connectServer(argv[1]);
+	if(fd == -1)
+		runDirectly(argv + 2);
+
+	Buffer payload = {NULL, 0, 0};
+	QCliServerRequest header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, QCLI_SERVER_MAGIC, sizeof(QCLI_SERVER_MAGIC));
+	header.version = QCLI_SERVER_VERSION;
+
+	char workingDirectory[PATH_MAX];
+	int ok = getcwd(workingDirectory, sizeof(workingDirectory)) != NULL &&
+			 appendString(&payload, workingDirectory);
+	for(int i = 2; ok && i < argc; ++i, ++header.argCount)
+		ok = appendString(&payload, argv[i]);
+	for(char **entry = environ; ok && entry && *entry; ++entry, ++header.envCount)
+		ok = appendString(&payload, *entry);
+	if(!ok || payload.size > QCLI_SERVER_MAX_REQUEST_SIZE) {
+		fputs("qcli-client: failed to create the request\n", stderr);
+		return EXIT_FAILURE;
+	}
+	header.size = (uint32_t)payload.size;
+
+	QCliServerResponse response;
+	if(!sendHeader(fd, &header) ||
+	   !writeAll(fd, payload.data, payload.size) ||
+	   !readAll(fd, (char*)&response, sizeof(response))) {
+		fputs("qcli-client: lost the connection to the server\n", stderr);
+		return EXIT_FAILURE;
+	}
+	free(payload.data);
+	close(fd);
+	return response.exitCode;
+}
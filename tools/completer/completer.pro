@@ -0,0 +1,13 @@
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle qt
+
+TARGET = qcliparser-complete
+
+INCLUDEPATH += ../..
+
+SOURCES += main.c
+
+target.path = $$[QT_INSTALL_BINS]
+INSTALLS += target
@@ -0,0 +1,347 @@
+#include <qclicompletionindex.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Standalone resolver for completion indexes written by QCliParser::writeCompletionIndex.
+// Called by the completion scripts as: qcliparser-complete <index> <current word index> <words...>
+// It prints the same candidates as <program> --__complete, without starting the application.
+// Exits with 2 if it cannot answer (invalid or outdated index, lazy context), so the script asks the application
+
+#define EXIT_FALLBACK 2
+
+typedef struct {
+	const char *data;
+	size_t size;
+	const QCliIndexHeader *header;
+	const QCliIndexNode *nodes;
+	const QCliIndexOption *options;
+	const uint32_t *names;
+	const char *strings;
+} Index;
+
+typedef struct {
+	uint32_t *items;
+	uint32_t count;
+	uint32_t capacity;
+} OptionList;
+
+static int isInRange(const Index *index, uint32_t offset, uint32_t count, size_t elementSize)
+{
+	return offset <= index->size &&
+		   (index->size - offset) / elementSize >= count;
+}
+
+static int openIndex(Index *index, const char *fileName)
+{
+	struct stat info;
+	const int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+	if(fd == -1)
+		return 0;
+	if(fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(QCliIndexHeader)) {
+		close(fd);
+		return 0;
+	}
+
+	index->size = (size_t)info.st_size;
+	index->data = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(index->data == MAP_FAILED)
+		return 0;
+
+	index->header = (const QCliIndexHeader*)index->data;
+	if(memcmp(index->header->magic, QCLI_INDEX_MAGIC, sizeof(QCLI_INDEX_MAGIC)) != 0 ||
+	   index->header->version != QCLI_INDEX_VERSION ||
+	   index->header->nodeCount == 0 ||
+	   !isInRange(index, index->header->nodeOffset, index->header->nodeCount, sizeof(QCliIndexNode)) ||
+	   !isInRange(index, index->header->optionOffset, index->header->optionCount, sizeof(QCliIndexOption)) ||
+	   !isInRange(index, index->header->nameOffset, index->header->nameCount, sizeof(uint32_t)) ||
+	   !isInRange(index, index->header->stringOffset, index->header->stringSize, 1) ||
+	   index->header->stringSize == 0 ||
+	   index->data[index->header->stringOffset + index->header->stringSize - 1] != '\0')
+		return 0;
+
+	index->nodes = (const QCliIndexNode*)(index->data + index->header->nodeOffset);
+	index->options = (const QCliIndexOption*)(index->data + index->header->optionOffset);
+	index->names = (const uint32_t*)(index->data + index->header->nameOffset);
+	index->strings = index->data + index->header->stringOffset;
+	return 1;
+}
+
+// the index is outdated if the application binary changed since it was written
+static int isCurrent(const Index *index)
+{
+	struct stat info;
+	const QCliIndexHeader *header = index->header;
+	if(header->program == 0)
+		return 1;
+	if(header->program >= header->stringSize ||
+	   stat(index->strings + header->program, &info) == -1)
+		return 0;
+	return (int64_t)info.st_mtime == header->programModified &&
+		   (uint64_t)info.st_size == header->programSize;
+}
+
+static const char *indexString(const Index *index, uint32_t offset)
+{
+	return offset < index->header->stringSize ? index->strings + offset : "";
+}
+
+static const char *indexName(const Index *index, uint32_t nameIndex)
+{
+	return nameIndex < index->header->nameCount ? indexString(index, index->names[nameIndex]) : "";
+}
+
+static int isValidNode(const Index *index, const QCliIndexNode *node)
+{
+	const QCliIndexHeader *header = index->header;
+	return node->firstChild <= header->nodeCount && header->nodeCount - node->firstChild >= node->childCount &&
+		   node->firstOption <= header->optionCount && header->optionCount - node->firstOption >= node->optionCount &&
+		   node->firstPositional <= header->nameCount && header->nameCount - node->firstPositional >= node->positionalCount;
+}
+
+static int isValidOption(const Index *index, const QCliIndexOption *option)
+{
+	return option->firstName <= index->header->nameCount &&
+		   index->header->nameCount - option->firstName >= option->nameCount;
+}
+
+// counts code points, so that the dashes match what QCliCompleter prints
+static size_t utf8Length(const char *string)
+{
+	size_t length = 0;
+	for(; *string; ++string) {
+		if(((unsigned char)*string & 0xC0) != 0x80)
+			++length;
+	}
+	return length;
+}
+
+static int startsWith(const char *string, const char *prefix)
+{
+	return strncmp(string, prefix, strlen(prefix)) == 0;
+}
+
+static const QCliIndexOption *findOption(const Index *index, const OptionList *list, const char *name, size_t nameLength)
+{
+	for(uint32_t i = 0; i < list->count; ++i) {
+		const QCliIndexOption *option = &index->options[list->items[i]];
+		for(uint32_t n = 0; n < option->nameCount; ++n) {
+			const char *optionName = indexName(index, option->firstName + n);
+			if(strlen(optionName) == nameLength && strncmp(optionName, name, nameLength) == 0)
+				return option;
+		}
+	}
+	return NULL;
+}
+
+// same semantics as QCommandLineParser::addOptions: options with already known names are skipped
+static int enterNode(const Index *index, OptionList *list, const QCliIndexNode *node)
+{
+	if(!isValidNode(index, node))
+		return 0;
+
+	for(uint32_t i = node->firstOption; i < node->firstOption + node->optionCount; ++i) {
+		const QCliIndexOption *option = &index->options[i];
+		int known = 0;
+		if(!isValidOption(index, option))
+			return 0;
+		for(uint32_t n = 0; n < option->nameCount && !known; ++n) {
+			const char *name = indexName(index, option->firstName + n);
+			known = findOption(index, list, name, strlen(name)) != NULL;
+		}
+		if(known)
+			continue;
+
+		if(list->count == list->capacity) {
+			uint32_t *items;
+			list->capacity = list->capacity ? list->capacity * 2 : 16;
+			items = realloc(list->items, list->capacity * sizeof(uint32_t));
+			if(!items)
+				return 0;
+			list->items = items;
+		}
+		list->items[list->count++] = i;
+	}
+	return 1;
+}
+
+// returns the option that takes a value from this word or the next one, if any
+static const QCliIndexOption *valueOption(const Index *index, const OptionList *list, const char *word, int *inlineValue)
+{
+	const QCliIndexOption *option;
+	if(startsWith(word, "--") || (index->header->flags & QCliIndexLongOptions)) {
+		const char *name = word + (startsWith(word, "--") ? 2 : 1);
+		const char *assign = strchr(name, '=');
+		*inlineValue = assign != NULL;
+		option = findOption(index, list, name, assign ? (size_t)(assign - name) : strlen(name));
+		return option && (option->flags & QCliIndexTakesValue) ? option : NULL;
+	}
+
+	// compacted short options: the first one that takes a value consumes the rest of the word
+	for(const char *pos = word + 1; *pos; ++pos) {
+		option = findOption(index, list, pos, 1);
+		if(option && (option->flags & QCliIndexTakesValue)) {
+			*inlineValue = pos[1] != '\0';
+			return option;
+		}
+	}
+	return NULL;
+}
+
+static const QCliIndexNode *findChild(const Index *index, const QCliIndexNode *node, const char *name)
+{
+	// children are sorted byte-wise by name
+	uint32_t begin = node->firstChild;
+	uint32_t end = node->firstChild + node->childCount;
+	while(begin < end) {
+		const uint32_t middle = begin + (end - begin) / 2;
+		const int compare = strcmp(indexString(index, index->nodes[middle].name), name);
+		if(compare == 0)
+			return &index->nodes[middle];
+		else if(compare < 0)
+			begin = middle + 1;
+		else
+			end = middle;
+	}
+	return NULL;
+}
+
+static void printCandidate(const char *name, const char *description)
+{
+	if(*description)
+		printf("%s\t%s\n", name, description);
+	else
+		printf("%s\n", name);
+}
+
+static void printFiles(const char *hint)
+{
+	printCandidate(":files", hint);
+}
+
+static void printOptions(const Index *index, const OptionList *list, const char *prefix)
+{
+	for(uint32_t i = 0; i < list->count; ++i) {
+		const QCliIndexOption *option = &index->options[list->items[i]];
+		if(option->flags & QCliIndexHidden)
+			continue;
+		for(uint32_t n = 0; n < option->nameCount; ++n) {
+			const char *name = indexName(index, option->firstName + n);
+			const char *dashes = utf8Length(name) == 1 ? "-" : "--";
+			const size_t dashCount = strlen(dashes);
+			const size_t prefixLength = strlen(prefix);
+			// "dashes + name" starts with prefix
+			if(strncmp(dashes, prefix, prefixLength < dashCount ? prefixLength : dashCount) != 0 ||
+			   (prefixLength > dashCount && !startsWith(name, prefix + dashCount)))
+				continue;
+			printf("%s%s", dashes, name);
+			if(*indexString(index, option->description))
+				printf("\t%s", indexString(index, option->description));
+			printf("\n");
+		}
+	}
+}
+
+static int complete(const Index *index, char **words, int wordCount, int currentWord)
+{
+	OptionList list = {NULL, 0, 0};
+	const QCliIndexNode *node = &index->nodes[0];
+	const QCliIndexOption *option;
+	const char *prefix;
+	int positionalOnly = 0;
+	int positionalIndex = 0;
+	int inlineValue = 0;
+	const int lastWord = currentWord < wordCount ? currentWord : wordCount;
+	int result = EXIT_FALLBACK;
+
+	if(!enterNode(index, &list, node))
+		goto done;
+
+	// walk all words before the current one to find the node that is completed
+	for(int i = 1; i < lastWord; ++i) {
+		const char *word = words[i];
+		if(!positionalOnly && strcmp(word, "--") == 0) {
+			positionalOnly = 1;
+			continue;
+		}
+
+		if(!positionalOnly && word[0] == '-' && word[1] != '\0') {
+			option = valueOption(index, &list, word, &inlineValue);
+			if(option && !inlineValue && ++i == lastWord) { // the current word is the value
+				printFiles(indexString(index, option->valueName));
+				result = EXIT_SUCCESS;
+				goto done;
+			}
+			continue;
+		}
+
+		if(node->flags & QCliIndexContext) {
+			node = findChild(index, node, word);
+			if(!node) { // unknown command -> nothing to complete
+				result = EXIT_SUCCESS;
+				goto done;
+			}
+			if((node->flags & QCliIndexLazy) || !enterNode(index, &list, node))
+				goto done;
+		} else
+			++positionalIndex;
+	}
+
+	prefix = currentWord < wordCount ? words[currentWord] : "";
+	if(!positionalOnly && prefix[0] == '-') {
+		option = valueOption(index, &list, prefix, &inlineValue);
+		if(option && inlineValue)
+			printFiles(indexString(index, option->valueName));
+		else
+			printOptions(index, &list, prefix);
+	} else if(node->flags & QCliIndexContext) {
+		for(uint32_t i = node->firstChild; i < node->firstChild + node->childCount; ++i) {
+			const QCliIndexNode *child = &index->nodes[i];
+			const char *name = indexString(index, child->name);
+			if(!(child->flags & QCliIndexHidden) && startsWith(name, prefix))
+				printCandidate(name, indexString(index, child->description));
+		}
+	} else {
+		// additional arguments are treated like the last one (e.g. "files...")
+		if(node->positionalCount == 0)
+			printFiles("");
+		else {
+			const uint32_t hint = (uint32_t)positionalIndex < node->positionalCount ?
+									  (uint32_t)positionalIndex :
+									  node->positionalCount - 1;
+			printFiles(indexName(index, node->firstPositional + hint));
+		}
+	}
+	result = EXIT_SUCCESS;
+
+done:
+	free(list.items);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	Index index;
+	char *end;
+	long currentWord;
+	if(argc < 3) {
+		fprintf(stderr, "Usage: %s <index> <current word index> <words...>\n", argv[0]);
+		return EXIT_FALLBACK;
+	}
+
+	// word 0 is the program, so only positive indexes can be completed
+	currentWord = strtol(argv[2], &end, 10);
+	if(end == argv[2] || *end != '\0' || currentWord < 1 || currentWord > INT_MAX)
+		return EXIT_FALLBACK;
+
+	if(!openIndex(&index, argv[1]) || !isCurrent(&index))
+		return EXIT_FALLBACK;
+	return complete(&index, argv + 3, argc - 3, (int)currentWord);
+}
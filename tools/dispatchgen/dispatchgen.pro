@@ -0,0 +1,15 @@
+TEMPLATE = app
+
+QT += core
+QT -= gui
+
+CONFIG += c++17 warning_clean exceptions console
+CONFIG -= app_bundle
+DEFINES += QT_DEPRECATED_WARNINGS QT_ASCII_CAST_WARNINGS QT_USE_QSTRINGBUILDER
+
+TARGET = qcli-dispatchgen
+
+SOURCES += main.cpp
+
+target.path = $$[QT_INSTALL_BINS]
+INSTALLS += target
@@ -0,0 +1,525 @@
+// qcli-dispatchgen: reads a header with Q_CLI_CONTEXT_OBJECT annotated evaluators and generates a
+// dispatch table for QCliEvaluator, that calls the evaluator methods directly (see qclidispatch.h).
+// The header is scanned much like moc does it, so only the declarations moc understands are supported
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QSaveFile>
+#include <QRegularExpression>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+struct Property {
+	QString type;
+	QString name;
+	QString member;
+	QString write;
+};
+
+struct Parameter {
+	QString type; // without const and reference
+	QString name;
+};
+
+struct Method {
+	QString name;
+	QVector<Parameter> parameters;
+};
+
+struct Class {
+	QString name;
+	QString base;
+	bool annotated = false;
+	QStringList path;
+	QString prefix = QStringLiteral("qCli_");
+	QVector<Property> properties;
+	QVector<Method> methods;
+};
+
+struct Target {
+	const Class *evaluator = nullptr;
+	QVector<Method> methods; // overloads, in declaration order
+};
+
+const QStringList ListTypes {
+	QStringLiteral("QStringList"),
+	QStringLiteral("QByteArrayList"),
+	QStringLiteral("QVariantList"),
+	QStringLiteral("QCliPositionalRange")
+};
+
+[[noreturn]] void fail(const QString &message)
+{
+	fputs(qUtf8Printable(QStringLiteral("qcli-dispatchgen: ") + message + QLatin1Char('\n')), stderr);
+	exit(EXIT_FAILURE);
+}
+
+// index after the string or char literal that starts at index
+int skipLiteral(const QString &text, int index)
+{
+	const auto quote = text[index];
+	for(++index; index < text.size() && text[index] != quote; ++index) {
+		if(text[index] == QLatin1Char('\\'))
+			++index;
+	}
+	return index + 1;
+}
+
+QString stripComments(const QString &source)
+{
+	QString result;
+	result.reserve(source.size());
+	for(auto i = 0; i < source.size();) {
+		const auto c = source[i];
+		if(c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+			const auto end = skipLiteral(source, i);
+			result += source.midRef(i, end - i);
+			i = end;
+		} else if(source.midRef(i, 2) == QLatin1String("//")) {
+			i = source.indexOf(QLatin1Char('\n'), i);
+			if(i == -1)
+				break;
+		} else if(source.midRef(i, 2) == QLatin1String("/*")) {
+			const auto end = source.indexOf(QLatin1String("*/"), i + 2);
+			result += QLatin1Char(' ');
+			i = end == -1 ? source.size() : end + 2;
+		} else if(c == QLatin1Char('#')) { // preprocessor lines
+			while(i < source.size() && source[i] != QLatin1Char('\n')) {
+				if(source[i] == QLatin1Char('\\'))
+					++i;
+				++i;
+			}
+		} else {
+			result += c;
+			++i;
+		}
+	}
+	return result;
+}
+
+// index of the bracket that closes the one at index, or -1
+int closingBracket(const QString &text, int index)
+{
+	const auto open = text[index];
+	const auto close = open == QLatin1Char('{') ? QLatin1Char('}') : QLatin1Char(')');
+	auto depth = 0;
+	for(auto i = index; i < text.size();) {
+		const auto c = text[i];
+		if(c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+			i = skipLiteral(text, i);
+			continue;
+		}
+		if(c == open)
+			++depth;
+		else if(c == close && --depth == 0)
+			return i;
+		++i;
+	}
+	return -1;
+}
+
+// the class body without nested blocks - inline function bodies and initializers become a ';'
+QString flatten(const QString &body)
+{
+	QString result;
+	for(auto i = 0; i < body.size();) {
+		const auto c = body[i];
+		if(c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+			const auto end = skipLiteral(body, i);
+			result += body.midRef(i, end - i);
+			i = end;
+		} else if(c == QLatin1Char('{')) {
+			const auto end = closingBracket(body, i);
+			result += QLatin1Char(';');
+			i = end == -1 ? body.size() : end + 1;
+		} else {
+			result += c;
+			++i;
+		}
+	}
+	return result;
+}
+
+// removes all calls of macros starting with Q_ and returns (name, arguments) of each
+QList<QPair<QString, QString>> takeMacros(QString &text)
+{
+	static const QRegularExpression macroRegex {QStringLiteral(R"__(\bQ_[A-Z_]+\s*\()__")};
+	QList<QPair<QString, QString>> macros;
+	for(auto match = macroRegex.match(text); match.hasMatch(); match = macroRegex.match(text, match.capturedStart())) {
+		const auto open = match.capturedEnd() - 1;
+		const auto close = closingBracket(text, open);
+		if(close == -1)
+			fail(QStringLiteral("Unterminated macro %1").arg(match.captured()));
+		macros.append(qMakePair(match.captured().chopped(1).trimmed(), text.mid(open + 1, close - open - 1).simplified()));
+		text.remove(match.capturedStart(), close + 1 - match.capturedStart());
+	}
+	return macros;
+}
+
+QStringList splitTopLevel(const QString &text)
+{
+	QStringList parts;
+	auto depth = 0;
+	auto start = 0;
+	for(auto i = 0; i < text.size(); ++i) {
+		const auto c = text[i];
+		if(c == QLatin1Char('<') || c == QLatin1Char('(') || c == QLatin1Char('{'))
+			++depth;
+		else if(c == QLatin1Char('>') || c == QLatin1Char(')') || c == QLatin1Char('}'))
+			--depth;
+		else if(c == QLatin1Char(',') && depth == 0) {
+			parts.append(text.mid(start, i - start).trimmed());
+			start = i + 1;
+		}
+	}
+	if(!text.trimmed().isEmpty())
+		parts.append(text.mid(start).trimmed());
+	return parts;
+}
+
+Property parseProperty(const QString &arguments)
+{
+	static const QStringList keywords {
+		QStringLiteral("READ"), QStringLiteral("WRITE"), QStringLiteral("MEMBER"), QStringLiteral("RESET"),
+		QStringLiteral("NOTIFY"), QStringLiteral("REVISION"), QStringLiteral("DESIGNABLE"), QStringLiteral("SCRIPTABLE"),
+		QStringLiteral("STORED"), QStringLiteral("USER"), QStringLiteral("CONSTANT"), QStringLiteral("FINAL"),
+		QStringLiteral("REQUIRED")
+	};
+	const auto tokens = arguments.split(QLatin1Char(' '));
+	Property property;
+	for(auto i = 0; i < tokens.size(); ++i) {
+		if(!keywords.contains(tokens[i]))
+			continue;
+		if(property.name.isEmpty()) {
+			property.name = tokens.value(i - 1);
+			property.type = tokens.mid(0, i - 1).join(QLatin1Char(' '));
+		}
+		if(tokens[i] == QStringLiteral("MEMBER"))
+			property.member = tokens.value(i + 1);
+		else if(tokens[i] == QStringLiteral("WRITE"))
+			property.write = tokens.value(i + 1);
+	}
+	return property;
+}
+
+bool parseParameter(const QString &declaration, int index, Parameter &parameter)
+{
+	static const QRegularExpression parameterRegex {QStringLiteral(R"__(^(?:const\s+)?(.*?)\s*(&{0,2})\s*(\w*)$)__")};
+	auto text = declaration;
+	const auto defaultPos = text.indexOf(QLatin1Char('='));
+	if(defaultPos != -1)
+		text.truncate(defaultPos);
+	const auto match = parameterRegex.match(text.simplified());
+	if(!match.hasMatch())
+		return false;
+	parameter.type = match.captured(1);
+	parameter.name = match.captured(3);
+	// "QString" alone is a type without a name
+	if(parameter.type.isEmpty()) {
+		parameter.type = parameter.name;
+		parameter.name.clear();
+	}
+	if(parameter.name.isEmpty())
+		parameter.name = QStringLiteral("arg%1").arg(index);
+	return !parameter.type.contains(QLatin1Char('*'));
+}
+
+void parseBody(Class &info, QString body)
+{
+	for(const auto &macro : takeMacros(body)) {
+		if(macro.first == QStringLiteral("Q_CLI_CONTEXT_OBJECT")) {
+			info.annotated = true;
+			for(const auto &segment : macro.second.split(QLatin1Char('.'))) {
+				if(!segment.trimmed().isEmpty())
+					info.path.append(segment.trimmed());
+			}
+		} else if(macro.first == QStringLiteral("Q_CLI_PREFIX"))
+			info.prefix = macro.second + QLatin1Char('_');
+		else if(macro.first == QStringLiteral("Q_PROPERTY")) {
+			const auto property = parseProperty(macro.second);
+			if(!property.member.isEmpty() || !property.write.isEmpty())
+				info.properties.append(property);
+		}
+	}
+
+	static const QRegularExpression accessRegex {QStringLiteral(R"__(^\s*(public|protected|private|signals|Q_SIGNALS)\b\s*(?:slots|Q_SLOTS)?\s*:(?!:))__")};
+	static const QRegularExpression specifierRegex {QStringLiteral(R"__(\b(Q_OBJECT|Q_GADGET|Q_INVOKABLE|Q_SLOT|Q_REQUIRED_RESULT|virtual|inline)\b)__")};
+	static const QRegularExpression methodRegex {QStringLiteral(R"__(^(static\s+)?int\s+(\w+)\s*\((.*)\)\s*(?:const\s*)?(?:noexcept\s*)?(?:override\s*)?(?:final\s*)?(?:=\s*0\s*)?$)__")};
+	auto access = QStringLiteral("private");
+	for(auto statement : flatten(body).split(QLatin1Char(';'))) {
+		statement.remove(specifierRegex);
+		for(auto match = accessRegex.match(statement); match.hasMatch(); match = accessRegex.match(statement)) {
+			access = match.captured(1);
+			statement.remove(0, match.capturedEnd());
+		}
+
+		const auto match = methodRegex.match(statement.simplified());
+		if(access != QStringLiteral("public") || !match.hasMatch() || !match.captured(1).isEmpty())
+			continue;
+		Method method;
+		method.name = match.captured(2);
+		auto supported = true;
+		const auto parameters = splitTopLevel(match.captured(3));
+		for(auto i = 0; supported && i < parameters.size(); ++i) {
+			Parameter parameter;
+			supported = parseParameter(parameters[i], i, parameter);
+			method.parameters.append(parameter);
+		}
+		if(supported)
+			info.methods.append(method);
+		else
+			fprintf(stderr, "qcli-dispatchgen: skipping %s::%s - pointer parameters are not supported\n",
+					qUtf8Printable(info.name), qUtf8Printable(method.name));
+	}
+}
+
+QVector<Class> parseClasses(const QString &source)
+{
+	static const QRegularExpression classRegex {QStringLiteral(R"__(\b(?:class|struct)\s+(?:\w+\s+)?(\w+)\s*(?:final\s*)?(?::\s*([^{;]*))?\{)__")};
+	static const QRegularExpression baseRegex {QStringLiteral(R"__(^(?:(?:public|protected|private|virtual)\s+)*([\w:]+))__")};
+	QVector<Class> classes;
+	for(auto match = classRegex.match(source); match.hasMatch(); ) {
+		const auto open = match.capturedEnd() - 1;
+		const auto close = closingBracket(source, open);
+		if(close == -1)
+			fail(QStringLiteral("Unterminated class %1").arg(match.captured(1)));
+
+		Class info;
+		info.name = match.captured(1);
+		info.base = baseRegex.match(match.captured(2).trimmed()).captured(1);
+		parseBody(info, source.mid(open + 1, close - open - 1));
+		classes.append(info);
+		match = classRegex.match(source, close + 1);
+	}
+	return classes;
+}
+
+// the properties and methods of a class and of all its bases within the same header
+template <typename T>
+QVector<T> collect(const Class &info, const QHash<QString, const Class*> &classes, QVector<T> Class::*member)
+{
+	QVector<T> items;
+	QStringList visited;
+	for(auto current = &info; current && !visited.contains(current->name); current = classes.value(current->base)) {
+		visited.append(current->name);
+		items = current->*member + items;
+	}
+	return items;
+}
+
+QString cString(const QString &string)
+{
+	auto escaped = string;
+	escaped.replace(QLatin1Char('\\'), QStringLiteral("\\\\")).replace(QLatin1Char('"'), QStringLiteral("\\\""));
+	return QLatin1Char('"') + escaped + QLatin1Char('"');
+}
+
+QString generateOption(const Property &property)
+{
+	const auto name = cString(QString{property.name}.replace(QLatin1Char('_'), QLatin1Char('-')));
+	const auto assign = [&](const QString &value) {
+		return property.member.isEmpty() ?
+					QStringLiteral("instance.%1(%2);").arg(property.write, value) :
+					QStringLiteral("instance.%1 = %2;").arg(property.member, value);
+	};
+
+	// typed options are read as converted by the parser
+	QString code;
+	if(property.type == QStringLiteral("bool"))
+		code += QStringLiteral("\tif(QCliDispatch::optionFlag(result, %1, flag))\n\t\t%2\n").arg(name, assign(QStringLiteral("flag")));
+	else if(property.type == QStringLiteral("QStringList"))
+		code += QStringLiteral("\tif(QCliDispatch::optionValues(result, %1, values))\n\t\t%2\n").arg(name, assign(QStringLiteral("values")));
+	else {
+		code += QStringLiteral("\tif(QCliDispatch::optionValue(result, %1, variant)) {\n").arg(name);
+		code += QStringLiteral("\t\t%1 value;\n").arg(property.type);
+		code += QStringLiteral("\t\tif(!QCliDispatch::convert(variant, value))\n");
+		code += QStringLiteral("\t\t\treturn QCliDispatch::optionError(%1, %2);\n").arg(name, cString(property.type));
+		code += QStringLiteral("\t\t%1\n\t}\n").arg(assign(QStringLiteral("std::move(value)")));
+	}
+	return code;
+}
+
+QString generateCall(const Method &method)
+{
+	auto argCount = method.parameters.size();
+	QString listType;
+	if(argCount > 0 && ListTypes.contains(method.parameters.last().type))
+		listType = method.parameters[--argCount].type;
+
+	QString code = listType.isEmpty() ?
+					   QStringLiteral("\tif(argCount == %1) {\n").arg(argCount) :
+					   QStringLiteral("\tif(argCount >= %1) {\n").arg(argCount);
+	QStringList names;
+	for(auto i = 0; i < argCount; ++i) {
+		const auto &parameter = method.parameters[i];
+		const auto name = QStringLiteral("arg%1").arg(i);
+		code += QStringLiteral("\t\t%1 %2;\n").arg(parameter.type, name);
+		code += QStringLiteral("\t\tif(!QCliDispatch::convert(result.typedPositionalArgument(%1), %2))\n").arg(i).arg(name);
+		code += QStringLiteral("\t\t\treturn QCliDispatch::argumentError(%1, %2);\n").arg(i).arg(cString(parameter.type));
+		names.append(name);
+	}
+	if(listType == QStringLiteral("QCliPositionalRange"))
+		names.append(QStringLiteral("result.positionalRange(%1)").arg(argCount));
+	else if(!listType.isEmpty()) {
+		const auto value = listType == QStringLiteral("QByteArrayList") ?
+							   QStringLiteral("result.positionalArgumentUtf8(i)") :
+							   listType == QStringLiteral("QVariantList") ?
+								   QStringLiteral("QVariant{result.positionalArgument(i)}") :
+								   QStringLiteral("result.positionalArgument(i)");
+		code += QStringLiteral("\t\t%1 list;\n").arg(listType);
+		code += QStringLiteral("\t\tlist.reserve(argCount - %1);\n").arg(argCount);
+		code += QStringLiteral("\t\tfor(auto i = %1; i < argCount; ++i)\n").arg(argCount);
+		code += QStringLiteral("\t\t\tlist.append(%1);\n").arg(value);
+		names.append(QStringLiteral("list"));
+	}
+	code += QStringLiteral("\t\treturn instance.%1(%2);\n\t}\n").arg(method.name, names.join(QStringLiteral(", ")));
+	return code;
+}
+
+QString generate(const QString &include, const QMap<QByteArray, Target> &targets)
+{
+	QString code;
+	code += QStringLiteral("// Generated by qcli-dispatchgen - do not edit\n");
+	code += QStringLiteral("#include %1\n").arg(cString(include));
+	code += QStringLiteral("#include <qclidispatch.h>\n#include <qclipositionalrange.h>\n");
+	if(targets.isEmpty())
+		return code;
+
+	code += QStringLiteral("\nnamespace {\n");
+	auto index = 0;
+	for(auto it = targets.constBegin(); it != targets.constEnd(); ++it, ++index) {
+		const auto &target = *it;
+		code += QStringLiteral("\n// %1\n").arg(QString::fromUtf8(it.key()));
+		code += QStringLiteral("int dispatch%1(const QCliParseResult &result, QObject *parent)\n{\n").arg(index);
+		code += QStringLiteral("\t%1 instance{parent};\n").arg(target.evaluator->name);
+		QString optionCode;
+		auto needsValues = false, needsVariant = false, needsFlag = false;
+		for(const auto &property : target.evaluator->properties) {
+			needsFlag = needsFlag || property.type == QStringLiteral("bool");
+			needsValues = needsValues || property.type == QStringLiteral("QStringList");
+			needsVariant = needsVariant || (property.type != QStringLiteral("bool") && property.type != QStringLiteral("QStringList"));
+			optionCode += generateOption(property);
+		}
+		if(needsValues)
+			code += QStringLiteral("\tQStringList values;\n");
+		if(needsVariant)
+			code += QStringLiteral("\tQVariant variant;\n");
+		if(needsFlag)
+			code += QStringLiteral("\tbool flag;\n");
+		code += optionCode;
+
+		auto minArgs = std::numeric_limits<int>::max();
+		auto maxArgs = 0;
+		code += QStringLiteral("\n\tconst auto argCount = result.positionalArgumentCount();\n");
+		for(const auto &method : target.methods) {
+			const auto isList = !method.parameters.isEmpty() && ListTypes.contains(method.parameters.last().type);
+			const auto argCount = method.parameters.size() - (isList ? 1 : 0);
+			minArgs = std::min(minArgs, argCount);
+			maxArgs = isList || maxArgs == -1 ? -1 : std::max(maxArgs, argCount);
+			code += generateCall(method);
+		}
+		code += QStringLiteral("\treturn QCliDispatch::argumentCountError(%1, %2, argCount);\n}\n").arg(minArgs).arg(maxArgs);
+	}
+
+	code += QStringLiteral("\nconst QCliDispatchEntry dispatchTable[] = {\n");
+	index = 0;
+	for(auto it = targets.constBegin(); it != targets.constEnd(); ++it, ++index) {
+		code += QStringLiteral("\t{%1, &%2::staticMetaObject, %3, &dispatch%4},\n")
+				.arg(cString(QString::fromUtf8(it.key())),
+					 it->evaluator->name,
+					 cString(it->methods.first().name))
+				.arg(index);
+	}
+	code += QStringLiteral("};\n\n");
+	code += QStringLiteral("void registerDispatchTable()\n{\n");
+	code += QStringLiteral("\tQCliDispatch::registerTable(dispatchTable, sizeof(dispatchTable) / sizeof(QCliDispatchEntry));\n}\n\n");
+	code += QStringLiteral("}\n\nQ_CONSTRUCTOR_FUNCTION(registerDispatchTable)\n");
+	return code;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName(QStringLiteral("qcli-dispatchgen"));
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QStringLiteral("Generates static dispatch tables for QCliEvaluator"));
+	parser.addHelpOption();
+	parser.addOption({
+						 {QStringLiteral("o"), QStringLiteral("output")},
+						 QStringLiteral("Write the generated code to <file> instead of stdout"),
+						 QStringLiteral("file")
+					 });
+	parser.addOption({
+						 {QStringLiteral("i"), QStringLiteral("include")},
+						 QStringLiteral("The <path> the generated code includes the header with. Defaults to the header path"),
+						 QStringLiteral("path")
+					 });
+	parser.addPositionalArgument(QStringLiteral("header"), QStringLiteral("The header with the annotated evaluators"));
+	parser.process(app);
+	if(parser.positionalArguments().size() != 1)
+		parser.showHelp(EXIT_FAILURE);
+
+	const auto header = parser.positionalArguments().first();
+	QFile file{header};
+	if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		fail(QStringLiteral("Unable to read %1: %2").arg(header, file.errorString()));
+	const auto classes = parseClasses(stripComments(QString::fromUtf8(file.readAll())));
+
+	QHash<QString, const Class*> classIndex;
+	for(const auto &info : classes)
+		classIndex.insert(info.name, &info);
+
+	// evaluators with all their inherited members, then their methods by context chain
+	QVector<Class> evaluators;
+	for(const auto &info : classes) {
+		if(!info.annotated)
+			continue;
+		auto evaluator = info;
+		evaluator.properties = collect(info, classIndex, &Class::properties);
+		evaluator.methods = collect(info, classIndex, &Class::methods);
+		evaluators.append(evaluator);
+	}
+	QMap<QByteArray, Target> targets;
+	for(const auto &evaluator : evaluators) {
+		for(const auto &method : evaluator.methods) {
+			auto path = evaluator.path;
+			if(method.name.startsWith(QStringLiteral("exec_")))
+				path.append(method.name.mid(5).split(QLatin1Char('_')));
+			else if(method.name.startsWith(evaluator.prefix) && method.name.size() > evaluator.prefix.size())
+				path.append(method.name.mid(evaluator.prefix.size()).replace(QLatin1Char('_'), QLatin1Char('-')));
+			else if(method.name != QStringLiteral("exec"))
+				continue;
+
+			auto &target = targets[path.join(QLatin1Char(' ')).toUtf8()];
+			if(target.evaluator && target.evaluator->name != evaluator.name)
+				fail(QStringLiteral("%1 and %2 both handle \"%3\"").arg(target.evaluator->name, evaluator.name, path.join(QLatin1Char(' '))));
+			// the evaluator calls the overloads of one method name only
+			if(!target.methods.isEmpty() && target.methods.first().name != method.name)
+				fail(QStringLiteral("%1::%2 and %1::%3 both handle \"%4\"").arg(evaluator.name, target.methods.first().name, method.name, path.join(QLatin1Char(' '))));
+			target.evaluator = &evaluator;
+			target.methods.append(method);
+		}
+	}
+
+	const auto code = generate(parser.isSet(QStringLiteral("include")) ? parser.value(QStringLiteral("include")) : header, targets);
+	if(!parser.isSet(QStringLiteral("output"))) {
+		fputs(qUtf8Printable(code), stdout);
+		return EXIT_SUCCESS;
+	}
+	QSaveFile output{parser.value(QStringLiteral("output"))};
+	if(!output.open(QIODevice::WriteOnly | QIODevice::Text) ||
+	   output.write(code.toUtf8()) == -1 ||
+	   !output.commit())
+		fail(QStringLiteral("Unable to write %1: %2").arg(output.fileName(), output.errorString()));
+	return EXIT_SUCCESS;
+}
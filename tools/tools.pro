@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+	dispatchgen
+
+# the resolver maps the index with POSIX calls, and the client talks to a Unix domain socket
+unix: SUBDIRS += completer client